@@ -2,6 +2,9 @@
 #include "util.h"
 #include <rlc/array.h>
 #include <rlc/colorprint.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #if 0
 VEC_IMPLEMENT(VCs, vcs, const char *, BY_VAL, BASE, 0);
@@ -36,6 +39,7 @@ void populate_debug_messenger_create_info(VkDebugUtilsMessengerCreateInfoEXT *cr
 static void framebuffer_resize_callback(GLFWwindow *window, int width, int height) {
     App *app = glfwGetWindowUserPointer(window);
     app->framebuffer_resized = true;
+    app->framebuffer_resized_at = frame_stats_now();
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -50,11 +54,20 @@ int app_init_glfw(App *app) { /*{{{*/
     log_down(&app->log, "initialize glfw");
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    log_ok(&app->log, "initialized glfw");
+    log_up(&app->log);
+    return 0;
+} /*}}}*/
+
+int app_init_glfw_create_window(App *app) { /*{{{*/
+    assert_arg(app);
+    if(app->display != APP_DISPLAY_WINDOW) return 0;
+    log_down(&app->log, "create window");
     app->window = glfwCreateWindow(APP_WIDTH, APP_HEIGHT, app->name, 0, 0);
     glfwSetWindowUserPointer(app->window, app);
     glfwSetFramebufferSizeCallback(app->window, framebuffer_resize_callback);
     glfwSetKeyCallback(app->window, key_callback);
-    log_ok(&app->log, "initialized glfw");
+    log_ok(&app->log, "created window");
     log_up(&app->log);
     return (!app->window);
 } /*}}}*/
@@ -90,11 +103,18 @@ void get_required_extensions(App *app, const char ***required_extensions) { /*{{
     assert_arg(required_extensions);
     log_down(&app->log, "get required extensions");
     array_clear(*required_extensions);
-    uint32_t glfw_extension_count = 0;
-    char **glfw_extensions = (char **)glfwGetRequiredInstanceExtensions(&glfw_extension_count);
-    for(size_t i = 0; i < glfw_extension_count; ++i) {
-        log_info(&app->log, "require %s", glfw_extensions[i]);
-        array_push(*required_extensions, glfw_extensions[i]);
+    if(app->display == APP_DISPLAY_WINDOW) {
+        uint32_t glfw_extension_count = 0;
+        char **glfw_extensions = (char **)glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+        for(size_t i = 0; i < glfw_extension_count; ++i) {
+            log_info(&app->log, "require %s", glfw_extensions[i]);
+            array_push(*required_extensions, glfw_extensions[i]);
+        }
+    } else if(app->display == APP_DISPLAY_HEADLESS_SURFACE) {
+        log_info(&app->log, "require %s", VK_KHR_SURFACE_EXTENSION_NAME);
+        array_push(*required_extensions, VK_KHR_SURFACE_EXTENSION_NAME);
+        log_info(&app->log, "require %s", VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+        array_push(*required_extensions, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
     }
     if(app->validation.enable) {
         log_info(&app->log, "require %s", VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -107,6 +127,24 @@ void get_required_extensions(App *app, const char ***required_extensions) { /*{{
     log_up(&app->log);
 } /*}}}*/
 
+bool check_instance_extension_support(const char *name) { /*{{{*/
+    assert_arg(name);
+    uint32_t extension_count = 0;
+    vkEnumerateInstanceExtensionProperties(0, &extension_count, 0);
+    VkExtensionProperties *extension_properties = {0};
+    array_resize(extension_properties, extension_count);
+    vkEnumerateInstanceExtensionProperties(0, &extension_count, extension_properties);
+    bool found = false;
+    for(size_t i = 0; i < array_len(extension_properties); ++i) {
+        VkExtensionProperties extension = array_at(extension_properties, i);
+        if(strcmp(extension.extensionName, name)) continue;
+        found = true;
+        break;
+    }
+    array_free(extension_properties);
+    return found;
+} /*}}}*/
+
 int app_init_vulkan_create_instance(App *app) { /*{{{*/
     assert_arg(app);
     log_down(&app->log, "create instance");
@@ -114,6 +152,10 @@ int app_init_vulkan_create_instance(App *app) { /*{{{*/
     if(app->validation.enable && !app_init_check_validation_support(app)) {
         THROW("validation layers requested, but not available!");
     }
+    if(app->display == APP_DISPLAY_HEADLESS_SURFACE && !check_instance_extension_support(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME)) {
+        log_info(&app->log, "%s not available, render offscreen", VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+        app->display = APP_DISPLAY_OFFSCREEN;
+    }
     get_required_extensions(app, &app->required_extensions);
 
     log_info(&app->log, "set app info");
@@ -123,7 +165,7 @@ int app_init_vulkan_create_instance(App *app) { /*{{{*/
     app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.pEngineName = app->engine;
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    app_info.apiVersion = VK_API_VERSION_1_0;
+    app_info.apiVersion = VK_API_VERSION_1_1;
 
     log_info(&app->log, "set create info");
     VkDebugUtilsMessengerCreateInfoEXT debug_create_info = {0};
@@ -144,6 +186,10 @@ int app_init_vulkan_create_instance(App *app) { /*{{{*/
         create_info.pNext = 0;
     }
     try(vkCreateInstance(&create_info, 0, &app->instance));
+    /* the display mode is final now */
+    if(app->display != APP_DISPLAY_OFFSCREEN) {
+        array_push(app->device_extensions, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     log_ok(&app->log, "created instance");
     log_up(&app->log);
@@ -188,10 +234,27 @@ error:
     return -1;
 } /*}}}*/
 
+VkResult CreateHeadlessSurfaceEXT(VkInstance instance, const VkHeadlessSurfaceCreateInfoEXT *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkSurfaceKHR *pSurface) { /*{{{*/
+    PFN_vkCreateHeadlessSurfaceEXT func = (PFN_vkCreateHeadlessSurfaceEXT)
+        vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+    if(!func) THROW("could not find function");
+    return func(instance, pCreateInfo, pAllocator, pSurface);
+error:
+    return -1;
+} /*}}}*/
+
 int app_init_vulkan_create_surface(App *app) { /*{{{*/
     assert_arg(app);
+    if(app->display == APP_DISPLAY_OFFSCREEN) return 0;
     log_down(&app->log, "create surface");
-    try(glfwCreateWindowSurface(app->instance, app->window, 0, &app->surface));
+    if(app->display == APP_DISPLAY_HEADLESS_SURFACE) {
+        VkHeadlessSurfaceCreateInfoEXT create_info = {
+            .sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT,
+        };
+        try(CreateHeadlessSurfaceEXT(app->instance, &create_info, 0, &app->surface));
+    } else {
+        try(glfwCreateWindowSurface(app->instance, app->window, 0, &app->surface));
+    }
     log_ok(&app->log, "created surface");
     log_up(&app->log);
     return 0;
@@ -211,14 +274,7 @@ int app_init_vulkan_refresh_physical_devices(App *app) { /*{{{*/
     }
     array_resize(app->physical.available, device_count);
     vkEnumeratePhysicalDevices(app->instance, &device_count, app->physical.available);
-    for(size_t i = 0; i < array_len(app->physical.available); ++i) {
-        VkPhysicalDevice device = array_at(app->physical.available, i);
-        VkPhysicalDeviceProperties device_properties;
-        vkGetPhysicalDeviceProperties(device, &device_properties);
-        VkPhysicalDeviceFeatures device_features;
-        vkGetPhysicalDeviceFeatures(device, &device_features);
-        log_info(&app->log, "found '%s'", device_properties.deviceName);
-    }
+    log_info(&app->log, "found %u devices", device_count);
 
     log_ok(&app->log, "refreshed available physical devices");
     log_up(&app->log);
@@ -240,45 +296,63 @@ void find_queue_families(VkPhysicalDevice device, VkSurfaceKHR surface, QueueFam
         if(queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
             optional_u32_set(&indices->graphics_family, i);
         }
+        /* transfer only families are backed by the copy engines */
+        if((queue_family.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queue_family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            optional_u32_set(&indices->transfer_family, i);
+        }
+        /* compute without graphics runs next to the graphics queue */
+        if((queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            optional_u32_set(&indices->compute_family, i);
+        }
+        if(!surface) continue;
         VkBool32 present_support = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
         if(present_support) {
             optional_u32_set(&indices->present_family, i);
         }
     }
+    /* nothing is presented without a surface, so "present" on the graphics queue */
+    if(!surface && indices->graphics_family.has_value) {
+        optional_u32_set(&indices->present_family, indices->graphics_family.value);
+    }
+    if(!indices->transfer_family.has_value && indices->graphics_family.has_value) {
+        optional_u32_set(&indices->transfer_family, indices->graphics_family.value);
+    }
+    if(!indices->compute_family.has_value && indices->graphics_family.has_value) {
+        optional_u32_set(&indices->compute_family, indices->graphics_family.value);
+    }
     array_free(queue_families);
 } /*}}}*/
 
-bool check_device_extension_support(VkPhysicalDevice device, const char **device_extensions) { /*{{{*/
-    uint32_t extension_count;
-    vkEnumerateDeviceExtensionProperties(device, 0, &extension_count, 0);
-    VkExtensionProperties *extension_properties = {0};
-    bool found = false;
-    array_resize(extension_properties, extension_count);
-    vkEnumerateDeviceExtensionProperties(device, 0, &extension_count, extension_properties);
-    for(size_t j = 0; j < array_len(device_extensions); ++j) {
-        const char *required = array_at(device_extensions, j);
-        found = false;
-        for(size_t i = 0; i < array_len(extension_properties); ++i) {
-            VkExtensionProperties extension = array_at(extension_properties, i);
-            if(strcmp(extension.extensionName, required)) continue;
-            found = true;
-            break;
-        }
-        if(!found) goto clean;
+DeviceProfile *app_device_profile(App *app) { /*{{{*/
+    assert_arg(app);
+    return array_it(app->physical.cache.profiles, app->physical.profile);
+} /*}}}*/
+
+bool app_enable_optional_device_extension(App *app, const char *name) { /*{{{*/
+    assert_arg(app);
+    assert_arg(name);
+    if(!device_profile_has_extension(app_device_profile(app), name)) {
+        log_info(&app->log, "optional %s not available", name);
+        return false;
     }
-clean:
-    array_free(extension_properties);
-    return found;
+    log_info(&app->log, "enable optional %s", name);
+    array_push(app->device_extensions, name);
+    return true;
 } /*}}}*/
 
-bool is_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface, QueueFamilyIndices *indices, const char **device_extensions) { /*{{{*/
+bool is_device_suitable(DeviceProfile *profile, VkSurfaceKHR surface, QueueFamilyIndices *indices, const char **device_extensions) { /*{{{*/
+    assert_arg(profile);
+    VkPhysicalDevice device = profile->device;
     bool extensions_supported = false;
     bool swap_chain_adequate = false;
     SwapChainSupportDetails swap_chain_support = {0};
+    queue_family_indices_clear(indices);
     find_queue_families(device, surface, indices);
-    extensions_supported = check_device_extension_support(device, device_extensions);
-    if(extensions_supported) {
+    extensions_supported = device_profile_has_extensions(profile, device_extensions);
+    if(!surface) {
+        swap_chain_adequate = true;
+    } else if(extensions_supported) {
         swap_chain_support_query(device, surface, &swap_chain_support);
         swap_chain_adequate = array_len(swap_chain_support.formats) && 
             array_len(swap_chain_support.present_modes);
@@ -287,29 +361,186 @@ bool is_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface, QueueFami
     return queue_family_indices_is_complete(indices) && extensions_supported && swap_chain_adequate;
 } /*}}}*/
 
+bool app_device_matches(App *app, size_t available, const char *override) { /*{{{*/
+    assert_arg(app);
+    assert_arg(override);
+    char *end = 0;
+    unsigned long index = strtoul(override, &end, 10);
+    if(end != override && !*end) return index == available;
+    DeviceProfile *profile = array_it(app->physical.cache.profiles, array_at(app->physical.profiles, available));
+    return strstr(profile->name, override);
+} /*}}}*/
+
 int app_init_vulkan_pick_physical_device(App *app) { /*{{{*/
     assert_arg(app);
     log_down(&app->log, "pick physical device");
+    size_t *order = {0};
     try(app_init_vulkan_refresh_physical_devices(app));
+    DeviceCache *cache = &app->physical.cache;
+    if(!cache->path) cache->path = APP_DEVICE_CACHE_PATH;
+    try(device_cache_load(cache));
+    array_clear(app->physical.profiles);
     for(size_t i = 0; i < array_len(app->physical.available); ++i) {
         VkPhysicalDevice device = array_at(app->physical.available, i);
-        if(is_device_suitable(device, app->surface, &app->physical.indices, app->device_extensions)) {
-            app->physical.active = device; // TODO actually pick a suitable physical device
-            log_info(&app->log, "found suitable device");
-            break;
+        array_push(app->physical.profiles, device_cache_resolve(cache, device, app->surface));
+        array_push(order, i);
+    }
+    log_info(&app->log, "device cache '%s' (%zu hits, %zu misses)", cache->path, cache->hits, cache->misses);
+    /* highest score first, only a handful of devices so insertion sort */
+    bool present_required = app->surface;
+    for(size_t i = 1; i < array_len(order); ++i) {
+        size_t current = array_at(order, i);
+        int64_t score = device_profile_score(array_it(cache->profiles, array_at(app->physical.profiles, current)), present_required);
+        size_t j = i;
+        for(; j > 0; --j) {
+            size_t previous = array_at(order, j - 1);
+            if(device_profile_score(array_it(cache->profiles, array_at(app->physical.profiles, previous)), present_required) >= score) break;
+            *array_it(order, j) = previous;
         }
+        *array_it(order, j) = current;
+    }
+    for(size_t i = 0; i < array_len(order); ++i) {
+        size_t available = array_at(order, i);
+        DeviceProfile *profile = array_it(cache->profiles, array_at(app->physical.profiles, available));
+        log_info(&app->log, "[%zu] '%s' %s, score %lld", available, profile->name,
+                device_profile_type_str(profile->type), (long long)device_profile_score(profile, present_required));
+    }
+    const char *override = app->physical.override ? app->physical.override : getenv(APP_DEVICE_ENV);
+    for(size_t i = 0; i < array_len(order); ++i) {
+        size_t available = array_at(order, i);
+        if(override && !app_device_matches(app, available, override)) continue;
+        size_t index = array_at(app->physical.profiles, available);
+        if(!is_device_suitable(array_it(cache->profiles, index), app->surface, &app->physical.indices, app->device_extensions)) {
+            continue;
+        }
+        app->physical.active = array_at(app->physical.available, available);
+        app->physical.profile = index;
+        log_info(&app->log, "picked '%s'%s", app_device_profile(app)->name, override ? " (override)" : "");
+        break;
+    }
+    if(device_cache_save(cache)) {
+        log_info(&app->log, "failed to save device cache '%s'", cache->path);
     }
     if(!app->physical.active) {
+        if(override) log_info(&app->log, "'%s' matches no suitable device", override);
         THROW("no suitable device found");
     }
     log_ok(&app->log, "picked physical device");
     log_up(&app->log);
+    array_free(order);
     return 0;
 error:
     log_up(&app->log);
+    array_free(order);
     return -1;
 } /*}}}*/
 
+/* both extensions and their features, to measure when frames reach the screen */
+bool app_enable_present_wait(App *app, VkPhysicalDevicePresentIdFeaturesKHR *features) { /*{{{*/
+    assert_arg(app);
+    assert_arg(features);
+    if(app->display == APP_DISPLAY_OFFSCREEN) return false;
+    DeviceProfile *profile = app_device_profile(app);
+    if(profile->api_version < VK_API_VERSION_1_1 ||
+            !device_profile_has_extension(profile, VK_KHR_PRESENT_ID_EXTENSION_NAME) ||
+            !device_profile_has_extension(profile, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        log_info(&app->log, "optional present wait not available");
+        return false;
+    }
+    VkPhysicalDevicePresentWaitFeaturesKHR *present_wait = features->pNext;
+    VkPhysicalDeviceFeatures2 features2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = features,
+    };
+    vkGetPhysicalDeviceFeatures2(app->physical.active, &features2);
+    if(!features->presentId || !present_wait->presentWait) {
+        log_info(&app->log, "optional present wait not supported");
+        features->presentId = VK_FALSE;
+        present_wait->presentWait = VK_FALSE;
+        return false;
+    }
+    log_info(&app->log, "enable optional present wait");
+    array_push(app->device_extensions, VK_KHR_PRESENT_ID_EXTENSION_NAME);
+    array_push(app->device_extensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    return true;
+} /*}}}*/
+
+/* no VkRenderPass and VkFramebuffer objects, layouts are handled with synchronization2 barriers.
+ * on a 1.1 device dynamic rendering needs depth stencil resolve and render pass 2 enabled too */
+bool app_enable_dynamic_rendering(App *app, VkPhysicalDeviceDynamicRenderingFeaturesKHR *features) { /*{{{*/
+    assert_arg(app);
+    assert_arg(features);
+    if(app->force_render_pass) {
+        log_info(&app->log, "dynamic rendering disabled, using render pass");
+        return false;
+    }
+    DeviceProfile *profile = app_device_profile(app);
+    const char *extensions[] = {
+        VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+        VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+        VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+        VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+    };
+    if(profile->api_version < VK_API_VERSION_1_1) {
+        log_info(&app->log, "optional dynamic rendering not available");
+        return false;
+    }
+    for(size_t i = 0; i < sizearray(extensions); ++i) {
+        if(device_profile_has_extension(profile, extensions[i])) continue;
+        log_info(&app->log, "optional dynamic rendering not available, missing %s", extensions[i]);
+        return false;
+    }
+    VkPhysicalDeviceSynchronization2FeaturesKHR *synchronization2 = features->pNext;
+    VkPhysicalDeviceFeatures2 features2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = features,
+    };
+    vkGetPhysicalDeviceFeatures2(app->physical.active, &features2);
+    if(!features->dynamicRendering || !synchronization2->synchronization2) {
+        log_info(&app->log, "optional dynamic rendering not supported");
+        features->dynamicRendering = VK_FALSE;
+        synchronization2->synchronization2 = VK_FALSE;
+        return false;
+    }
+    log_info(&app->log, "enable optional dynamic rendering");
+    for(size_t i = 0; i < sizearray(extensions); ++i) {
+        array_push(app->device_extensions, extensions[i]);
+    }
+    return true;
+} /*}}}*/
+
+/* only the update after bind bits the bindless set uses are enabled */
+bool app_enable_descriptor_indexing(App *app, VkPhysicalDeviceDescriptorIndexingFeaturesEXT *features) { /*{{{*/
+    assert_arg(app);
+    assert_arg(features);
+    DeviceProfile *profile = app_device_profile(app);
+    if(profile->api_version < VK_API_VERSION_1_1 ||
+            !device_profile_has_extension(profile, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        log_info(&app->log, "optional descriptor indexing not available, bindless slots are fixed once bound");
+        return false;
+    }
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+    };
+    VkPhysicalDeviceFeatures2 features2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &supported,
+    };
+    vkGetPhysicalDeviceFeatures2(app->physical.active, &features2);
+    if(!supported.descriptorBindingSampledImageUpdateAfterBind ||
+            !supported.descriptorBindingStorageBufferUpdateAfterBind ||
+            !supported.descriptorBindingUpdateUnusedWhilePending) {
+        log_info(&app->log, "optional descriptor indexing not supported, bindless slots are fixed once bound");
+        return false;
+    }
+    features->descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features->descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features->descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    log_info(&app->log, "enable optional %s", VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    array_push(app->device_extensions, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    return true;
+} /*}}}*/
+
 int app_init_vulkan_create_logical_device(App *app) { /*{{{*/
     assert_arg(app);
     log_down(&app->log, "create logical device");
@@ -319,6 +550,8 @@ int app_init_vulkan_create_logical_device(App *app) { /*{{{*/
     uint32_t queue_families[] = {
         app->physical.indices.graphics_family.value,
         app->physical.indices.present_family.value,
+        app->physical.indices.transfer_family.value,
+        app->physical.indices.compute_family.value,
     };
     float queue_priority = 1.0f;
     for(size_t i = 0; i < sizearray(queue_families); ++i) {
@@ -340,9 +573,79 @@ int app_init_vulkan_create_logical_device(App *app) { /*{{{*/
         array_push(queue_create_infos, queue_create_info);
     }
 
+    app->features.creation_feedback = app_enable_optional_device_extension(app, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+    };
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+        .pNext = &present_wait_features,
+    };
+    app->features.present_wait = app_enable_present_wait(app, &present_id_features);
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR,
+    };
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
+        .pNext = &synchronization2_features,
+    };
+    app->features.dynamic_rendering = app_enable_dynamic_rendering(app, &dynamic_rendering_features);
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+    };
+    app->features.descriptor_indexing = app_enable_descriptor_indexing(app, &descriptor_indexing_features);
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+        .timelineSemaphore = VK_TRUE,
+    };
+    /* append the optional feature pairs behind the timeline */
+    void **features_tail = &timeline_features.pNext;
+    if(app->features.present_wait) {
+        *features_tail = &present_id_features;
+        features_tail = &present_wait_features.pNext;
+    }
+    if(app->features.dynamic_rendering) {
+        *features_tail = &dynamic_rendering_features;
+        features_tail = &synchronization2_features.pNext;
+    }
+    if(app->features.descriptor_indexing) {
+        *features_tail = &descriptor_indexing_features;
+        features_tail = &descriptor_indexing_features.pNext;
+    }
+
     VkPhysicalDeviceFeatures device_features = {0};
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(app->physical.active, &supported_features);
+    /* the bindless arrays are indexed with push constants */
+    if(!supported_features.shaderSampledImageArrayDynamicIndexing || !supported_features.shaderStorageBufferArrayDynamicIndexing) {
+        THROW("bindless descriptors need dynamic indexing of sampler and storage buffer arrays");
+    }
+    device_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+    device_features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    /* streamed textures upload block compressed levels as they are where supported */
+    if(array_len(app->texture_paths) && supported_features.textureCompressionBC) {
+        device_features.textureCompressionBC = VK_TRUE;
+    }
+    /* the overdraw scene counts fragment shader invocations */
+    if(app->geometry.layers && supported_features.pipelineStatisticsQuery) {
+        device_features.pipelineStatisticsQuery = VK_TRUE;
+        app->features.pipeline_statistics = true;
+    }
+    /* gpu culling writes one command per object, each selecting its instance */
+    if(app->culling.enable) {
+        if(supported_features.multiDrawIndirect && supported_features.drawIndirectFirstInstance) {
+            device_features.multiDrawIndirect = VK_TRUE;
+            device_features.drawIndirectFirstInstance = VK_TRUE;
+            app->features.draw_indirect_count = app_enable_optional_device_extension(app, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        } else {
+            log_info(&app->log, "gpu culling needs multiDrawIndirect and drawIndirectFirstInstance, drawing from the cpu");
+            app->culling.enable = false;
+        }
+    }
     VkDeviceCreateInfo create_info = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &timeline_features,
         .pQueueCreateInfos = queue_create_infos,
         .queueCreateInfoCount = array_len(queue_create_infos),
         .pEnabledFeatures = &device_features,
@@ -361,6 +664,42 @@ int app_init_vulkan_create_logical_device(App *app) { /*{{{*/
     vkGetDeviceQueue(app->device, app->physical.indices.graphics_family.value, 0, &app->graphics_queue);
     log_info(&app->log, "get present queue");
     vkGetDeviceQueue(app->device, app->physical.indices.present_family.value, 0, &app->present_queue);
+    log_info(&app->log, "get transfer queue");
+    vkGetDeviceQueue(app->device, app->physical.indices.transfer_family.value, 0, &app->transfer_queue);
+    log_info(&app->log, "get compute queue");
+    vkGetDeviceQueue(app->device, app->physical.indices.compute_family.value, 0, &app->compute_queue);
+    log_info(&app->log, "set up gpu memory allocator");
+    gpu_memory_init(&app->gpu_memory, app->physical.active, app->device);
+    app->deletion_queue.gpu_memory = &app->gpu_memory;
+    app->deletion_queue.present_queue = app->present_queue;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(app->physical.active, &properties);
+    app->depth.format = attachment_depth_format(app->physical.active);
+    if(app->depth.format == VK_FORMAT_UNDEFINED) THROW("no depth attachment format");
+    log_info(&app->log, "depth format %u", (uint32_t)app->depth.format);
+    /* color and depth share the sample count */
+    app->msaa.samples = attachment_samples(properties.limits.framebufferColorSampleCounts &
+            properties.limits.framebufferDepthSampleCounts, app->msaa.requested);
+    if(app->msaa.requested > 1) {
+        log_info(&app->log, "msaa %ux (requested %ux)", (uint32_t)app->msaa.samples, app->msaa.requested);
+    }
+    app->timeline.wait = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(app->device, "vkWaitSemaphoresKHR");
+    app->timeline.value = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(app->device, "vkGetSemaphoreCounterValueKHR");
+    if(!app->timeline.wait || !app->timeline.value) THROW("could not find timeline semaphore functions");
+    if(app->features.present_wait) {
+        app->pacing.present.wait = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(app->device, "vkWaitForPresentKHR");
+        app->pacing.present.enable = (app->pacing.present.wait != 0);
+    }
+    if(app->features.dynamic_rendering) {
+        app->rendering.begin = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(app->device, "vkCmdBeginRenderingKHR");
+        app->rendering.end = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(app->device, "vkCmdEndRenderingKHR");
+        app->rendering.barrier = (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(app->device, "vkCmdPipelineBarrier2KHR");
+        if(!app->rendering.begin || !app->rendering.end || !app->rendering.barrier) THROW("could not find dynamic rendering functions");
+    }
+    if(app->features.draw_indirect_count) {
+        app->culling.draw_count = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(app->device, "vkCmdDrawIndexedIndirectCountKHR");
+        if(!app->culling.draw_count) THROW("could not find draw indirect count function");
+    }
     log_ok(&app->log, "created logical device");
     log_up(&app->log);
 clean:
@@ -384,24 +723,13 @@ VkSurfaceFormatKHR choose_swap_surface_format(VkSurfaceFormatKHR **available_for
     return *(*available_formats);
 }
 
-VkPresentModeKHR choose_swap_present_mode(VkPresentModeKHR **available_present_modes) {
-    assert_arg(available_present_modes);
-    for(size_t i = 0; i < array_len(*available_present_modes); ++i) {
-        VkPresentModeKHR available_present_mode = array_at(*available_present_modes, i);
-        if(available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return available_present_mode;
-        }
-    }
-    return VK_PRESENT_MODE_FIFO_KHR;
-}
-
 VkExtent2D choose_swap_extent(GLFWwindow *window, VkSurfaceCapabilitiesKHR *capabilities) {
     assert_arg(capabilities);
     if(capabilities->currentExtent.width != UINT32_MAX) {
         return capabilities->currentExtent;
     } else {
-        int width, height;
-        glfwGetFramebufferSize(window, &width, &height);
+        int width = APP_WIDTH, height = APP_HEIGHT;
+        if(window) glfwGetFramebufferSize(window, &width, &height);
         VkExtent2D actual_extent = {
             (uint32_t)width, (uint32_t)height,
         };
@@ -414,19 +742,71 @@ VkExtent2D choose_swap_extent(GLFWwindow *window, VkSurfaceCapabilitiesKHR *capa
     }
 }
 
+void app_log_gpu_memory(App *app) {
+    assert_arg(app);
+    GpuMemoryStats stats;
+    gpu_memory_stats(&app->gpu_memory, &stats);
+    log_info(&app->log, "gpu memory: %zu blocks, %zu dedicated, %zu/%u device allocations",
+            stats.blocks, stats.dedicated, stats.device_allocations, app->gpu_memory.max_allocations);
+    log_info(&app->log, "gpu memory: %zu allocations, %.2f/%.2f MiB used (%.2f MiB requested), %.1f%% fragmented",
+            stats.allocations, (double)stats.used / (1 << 20), (double)stats.reserved / (1 << 20),
+            (double)stats.requested / (1 << 20), stats.fragmentation * 100.0);
+}
+
+int app_init_vulkan_create_offscreen_images(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create %zu offscreen images", app->frames_in_flight);
+    app->swap_chain_extent = (VkExtent2D){ APP_WIDTH, APP_HEIGHT };
+    app->swap_chain_image_format = APP_OFFSCREEN_FORMAT;
+    /* one image per frame in flight: waiting for a frame on the timeline also guards its image */
+    array_resize(app->swap_chain_images, app->frames_in_flight);
+    array_resize(app->offscreen.allocations, app->frames_in_flight);
+    for(size_t i = 0; i < app->frames_in_flight; ++i) {
+        *array_it(app->swap_chain_images, i) = VK_NULL_HANDLE;
+        memset(array_it(app->offscreen.allocations, i), 0, sizeof(GpuAllocation));
+    }
+    for(size_t i = 0; i < app->frames_in_flight; ++i) {
+        log_info(&app->log, "create offscreen image #%zu", i);
+        VkImage *image = array_it(app->swap_chain_images, i);
+        GpuAllocation *allocation = array_it(app->offscreen.allocations, i);
+        VkImageCreateInfo image_info = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = app->swap_chain_image_format,
+            .extent = { app->swap_chain_extent.width, app->swap_chain_extent.height, 1 },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+        try(gpu_memory_create_image(&app->gpu_memory, &image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, image, allocation));
+    }
+    log_ok(&app->log, "created offscreen images");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
 int app_init_vulkan_create_swap_chain(App *app) {
     assert_arg(app);
+    if(app->display == APP_DISPLAY_OFFSCREEN) {
+        return app_init_vulkan_create_offscreen_images(app);
+    }
     log_down(&app->log, "create swap chain");
     int err = 0;
     SwapChainSupportDetails swap_chain_support = {0};
     swap_chain_support_query(app->physical.active, app->surface, &swap_chain_support);
     VkSurfaceFormatKHR surface_format = choose_swap_surface_format(&swap_chain_support.formats);
-    VkPresentModeKHR present_mode = choose_swap_present_mode(&swap_chain_support.present_modes);
+    VkPresentModeKHR present_mode = pacing_present_mode(&app->pacing, swap_chain_support.present_modes);
     VkExtent2D extent = choose_swap_extent(app->window, &swap_chain_support.capabilities);
-    uint32_t image_count = swap_chain_support.capabilities.minImageCount + 1;
-    if(swap_chain_support.capabilities.maxImageCount > 0 && image_count > swap_chain_support.capabilities.maxImageCount) {
-        image_count = swap_chain_support.capabilities.maxImageCount;
-    }
+    uint32_t image_count = pacing_image_count(&app->pacing, &swap_chain_support.capabilities);
+    log_info(&app->log, "pacing %s: %s, %u images", pacing_mode_str(app->pacing.mode),
+            pacing_present_mode_str(present_mode), image_count);
     VkSwapchainCreateInfoKHR create_info = {0};
     create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     create_info.surface = app->surface;
@@ -454,10 +834,20 @@ int app_init_vulkan_create_swap_chain(App *app) {
     create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     create_info.presentMode = present_mode;
     create_info.clipped = VK_TRUE;
-    create_info.oldSwapchain = VK_NULL_HANDLE;
+    /* lets the driver hand resources over and keep presenting the old images meanwhile */
+    create_info.oldSwapchain = app->swap_chain;
     app->swap_chain_extent = extent;
     app->swap_chain_image_format = surface_format.format;
     try(vkCreateSwapchainKHR(app->device, &create_info, 0, &app->swap_chain));
+    if(create_info.oldSwapchain) {
+        log_info(&app->log, "retire old swap chain");
+        /* kept until the next frame, normally the first presented on the new one, completed */
+        deletion_queue_push(&app->deletion_queue, (DeletionEntry){
+            .kind = DELETION_SWAP_CHAIN,
+            .frame = app->frame_count + 1,
+            .swap_chain = create_info.oldSwapchain,
+        });
+    }
     log_info(&app->log, "retrieve swap chain images");
     vkGetSwapchainImagesKHR(app->device, app->swap_chain, &image_count, 0);
     array_resize(app->swap_chain_images, image_count);
@@ -502,52 +892,82 @@ error:
     return -1;
 }
 
-int create_shader_module(VkDevice device, VkShaderModule *shader_module, const unsigned char *code, const unsigned int len) {
-    assert_arg(code);
-    VkShaderModuleCreateInfo create_info = {0};
-    create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    create_info.codeSize = len;
-    create_info.pCode = (uint32_t *)code;
-    try(vkCreateShaderModule(device, &create_info, 0, shader_module));
-    return 0;
-error:
-    return -1;
-}
-
 int app_init_vulkan_create_render_pass(App *app) {
     assert_arg(app);
+    if(app->features.dynamic_rendering) {
+        log_info(&app->log, "no render pass, using dynamic rendering");
+        return 0;
+    }
     log_down(&app->log, "create render pass");
-    VkAttachmentDescription color_attachment = {
-        .format = app->swap_chain_image_format,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
-        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+    bool msaa = app->msaa.samples > VK_SAMPLE_COUNT_1_BIT;
+    VkImageLayout final_layout = app->display == APP_DISPLAY_OFFSCREEN ?
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    /* 0 color, 1 depth, never stored. with msaa: 0 is the transient multisampled
+     * target, never stored either, 2 the swap chain image it resolves to */
+    VkAttachmentDescription attachments[] = {
+        {
+            .format = app->swap_chain_image_format,
+            .samples = app->msaa.samples,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = msaa ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = msaa ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : final_layout,
+        },
+        {
+            .format = app->depth.format,
+            .samples = app->msaa.samples,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        },
+        {
+            .format = app->swap_chain_image_format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = final_layout,
+        },
     };
     VkAttachmentReference color_attachment_ref = {
         .attachment = 0,
         .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
     };
+    VkAttachmentReference depth_attachment_ref = {
+        .attachment = 1,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+    VkAttachmentReference resolve_attachment_ref = {
+        .attachment = 2,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
     VkSubpassDescription subpass = {
         .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
         .colorAttachmentCount = 1,
         .pColorAttachments = &color_attachment_ref,
+        .pResolveAttachments = msaa ? &resolve_attachment_ref : 0,
+        .pDepthStencilAttachment = &depth_attachment_ref,
     };
+    /* the msaa and depth targets are shared by every frame, the previous frame's writes have to finish first */
     VkSubpassDependency dependency = {
         .srcSubpass = VK_SUBPASS_EXTERNAL,
         .dstSubpass = 0,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .srcAccessMask = 0,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        .srcAccessMask = (msaa ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0) | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
     };
     VkRenderPassCreateInfo render_pass_info = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &color_attachment,
+        .attachmentCount = msaa ? 3 : 2,
+        .pAttachments = attachments,
         .subpassCount = 1,
         .pSubpasses = &subpass,
         .dependencyCount = 1,
@@ -562,168 +982,148 @@ error:
     return -1;
 }
 
-#include "shaders/blob.h"
+int app_init_vulkan_create_pipeline_cache(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create pipeline cache");
+    if(!app->pipeline_cache.path) app->pipeline_cache.path = APP_PIPELINE_CACHE_PATH;
+    try(pipeline_cache_create(&app->pipeline_cache, app->physical.active, app->device));
+    log_info(&app->log, "'%s' %s (%zu bytes)", app->pipeline_cache.path,
+            pipeline_cache_status_str(app->pipeline_cache.status), app->pipeline_cache.loaded_size);
+    log_ok(&app->log, "created pipeline cache");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+int app_init_vulkan_create_shader_modules(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create shader modules");
+    try(shader_registry_init(&app->shaders));
+#ifdef SHADERS_ARCHIVE
+    log_info(&app->log, "%zu shaders mapped from '%s'", shader_registry_count(&app->shaders),
+            app->shaders.path ? app->shaders.path : SHADERS_ARCHIVE);
+#else
+    log_info(&app->log, "%zu shaders embedded", shader_registry_count(&app->shaders));
+#endif
+    try(shader_registry_create_module(&app->shaders, app->device, "shader.vert", &app->shader_modules.vert));
+    try(shader_registry_create_module(&app->shaders, app->device, "shader.frag", &app->shader_modules.frag));
+    log_ok(&app->log, "created shader modules");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+/* --variant NAME, the pipeline state drawn once its variant compiled */
+int app_variant_state(const char *name, PipelineState *state) {
+    assert_arg(state);
+    *state = pipeline_state_default();
+    if(!name || !strcmp(name, "default")) return 0;
+    if(!strcmp(name, "grayscale")) {
+        state->spec[PIPELINE_SPEC_COLOR_MODE] = 1;
+    } else if(!strcmp(name, "additive")) {
+        state->blend = PIPELINE_BLEND_ADDITIVE;
+    } else if(!strcmp(name, "nocull")) {
+        state->cull_mode = VK_CULL_MODE_NONE;
+    } else {
+        return -1;
+    }
+    return 0;
+}
 
 int app_init_vulkan_create_graphics_pipeline(App *app) {
     assert_arg(app);
-    int err = 0;
     log_down(&app->log, "create graphics pipeline");
-    log_info(&app->log, "create shader modules");
-    VkShaderModule vert_shader_module = 0, frag_shader_module = 0;
-    try(create_shader_module(app->device, &vert_shader_module, build_shaders_vert_spv, build_shaders_vert_spv_len));
-    try(create_shader_module(app->device, &frag_shader_module, build_shaders_frag_spv, build_shaders_frag_spv_len));
-    VkPipelineShaderStageCreateInfo vert_shader_stage_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_VERTEX_BIT,
-        .module = vert_shader_module,
-        .pName = "main",
-    };
-    VkPipelineShaderStageCreateInfo frag_shader_stage_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .module = frag_shader_module,
-        .pName = "main",
+    /* the bindless set, the frame uniforms and the per draw indices, shared by every variant */
+    VkPushConstantRange push_range = {
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .size = sizeof(BindlessPush),
     };
-    VkPipelineShaderStageCreateInfo shader_stages[] = {vert_shader_stage_info, frag_shader_stage_info};
-    log_info(&app->log, "create fixed function state");
-    VkDynamicState dynamic_states[] = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR,
-    };
-    VkPipelineDynamicStateCreateInfo dynamic_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = sizearray(dynamic_states),
-        .pDynamicStates = dynamic_states,
-    };
-    VkPipelineVertexInputStateCreateInfo vertex_input_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 0,
-        .pVertexBindingDescriptions = 0, // optional
-        .vertexAttributeDescriptionCount = 0,
-        .pVertexAttributeDescriptions = 0, // optional
-    };
-    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = VK_FALSE,
-    };
-    VkViewport viewport = {
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = (float)app->swap_chain_extent.width,
-        .height = (float)app->swap_chain_extent.height,
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f,
-    };
-    VkRect2D scissor = {
-        .offset = {0, 0},
-        .extent = app->swap_chain_extent,
-    };
-    VkPipelineViewportStateCreateInfo viewport_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .pViewports = &viewport,
-        .scissorCount = 1,
-        .pScissors = &scissor,
-    };
-    VkPipelineRasterizationStateCreateInfo rasterizer = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .depthClampEnable = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .lineWidth = 1.0f,
-        .cullMode = VK_CULL_MODE_BACK_BIT,
-        .frontFace = VK_FRONT_FACE_CLOCKWISE,
-        .depthBiasEnable = VK_FALSE,
-        .depthBiasConstantFactor = 0.0f, // optional
-        .depthBiasClamp = 0.0f, // optional
-        .depthBiasSlopeFactor = 0.0f, // optional
-    };
-    VkPipelineMultisampleStateCreateInfo multisampling = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .sampleShadingEnable = VK_FALSE,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-        .minSampleShading = 1.0f, // optional
-        .pSampleMask = 0, // optional
-        .alphaToCoverageEnable = VK_FALSE, // optional
-        .alphaToOneEnable = VK_FALSE, // optional
-    };
-    VkPipelineColorBlendAttachmentState color_blend_atttachment = {
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT,
-        .blendEnable = VK_FALSE,
-        // all optional below
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp = VK_BLEND_OP_ADD,
-    };
-    VkPipelineColorBlendStateCreateInfo color_blending = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .logicOpEnable = VK_FALSE,
-        .logicOp = VK_LOGIC_OP_COPY, // optional
-        .attachmentCount = 1,
-        .pAttachments = &color_blend_atttachment,
-        .blendConstants[0] = 0.0f, // optional
-        .blendConstants[1] = 0.0f, // optional
-        .blendConstants[2] = 0.0f, // optional
-        .blendConstants[3] = 0.0f, // optional
+    VkDescriptorSetLayout set_layouts[] = {
+        app->bindless.set_layout,
+        app->frame_uniforms.set_layout,
     };
     VkPipelineLayoutCreateInfo pipeline_layout_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        // optional below
-        .setLayoutCount = 0,
-        .pSetLayouts = 0,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = 0,
+        .setLayoutCount = sizearray(set_layouts),
+        .pSetLayouts = set_layouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_range,
     };
     try(vkCreatePipelineLayout(app->device, &pipeline_layout_info, 0, &app->pipeline_layout));
-    VkGraphicsPipelineCreateInfo pipeline_info = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = 2,
-        .pStages = shader_stages,
-        .pVertexInputState = &vertex_input_info,
-        .pInputAssemblyState = &input_assembly,
-        .pViewportState = &viewport_state,
-        .pRasterizationState = &rasterizer,
-        .pMultisampleState = &multisampling,
-        .pDepthStencilState = 0, // optional
-        .pColorBlendState = &color_blending,
-        .pDynamicState = &dynamic_state,
-        .layout = app->pipeline_layout,
-        .renderPass = app->render_pass,
-        .subpass = 0,
-        .basePipelineHandle = VK_NULL_HANDLE, // optional
-        .basePipelineIndex = -1, // optional
-    };
-    try(vkCreateGraphicsPipelines(app->device, VK_NULL_HANDLE, 1, &pipeline_info, 0, &app->graphics_pipeline));
+    try(pipeline_variants_init(&app->variants, app->device, &app->pipeline_cache, app->pipeline_layout,
+                app->render_pass, app->swap_chain_image_format, app->depth.format, app->msaa.samples,
+                app->bindless.slots[BINDLESS_TEXTURE].capacity, app->bindless.slots[BINDLESS_BUFFER].capacity, app->shader_modules.vert, app->shader_modules.frag, app->features.creation_feedback));
+    log_info(&app->log, "%zu variant compile threads", app->variants.started);
+    /* the default variant is what gets drawn while others compile, so it can't wait */
+    PipelineState state = pipeline_state_default();
+    PipelineVariant *variant = pipeline_variants_compile(&app->variants, &state);
+    if(!variant) THROW("failed to compile the default pipeline");
+    app->graphics_pipeline = variant->pipeline;
+    app->pipeline_bound = variant->pipeline;
+    if(!variant->cache_known) {
+        log_info(&app->log, "compiled in %.3fms, pipeline cache hit unknown", variant->compile_ms);
+    } else {
+        log_info(&app->log, "compiled in %.3fms, pipeline cache %s", variant->compile_ms, variant->cache_hit ? "hit" : "miss");
+    }
+    if(app_variant_state(app->variant_name, &app->variant)) {
+        log_info(&app->log, "unknown variant '%s'", app->variant_name);
+        THROW("unknown pipeline variant");
+    }
     log_ok(&app->log, "created graphics pipeline");
-clean:
-    vkDestroyShaderModule(app->device, vert_shader_module, 0);
-    vkDestroyShaderModule(app->device, frag_shader_module, 0);
     log_up(&app->log);
-    return err;
+    return 0;
 error:
-    err = -1;
-    goto clean;
+    log_up(&app->log);
+    return -1;
+}
+
+VkImageAspectFlags app_depth_aspect(App *app) {
+    assert_arg(app);
+    return VK_IMAGE_ASPECT_DEPTH_BIT | (attachment_has_stencil(app->depth.format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+}
+
+int app_init_vulkan_create_attachments(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create attachments");
+    if(app->msaa.samples > VK_SAMPLE_COUNT_1_BIT) {
+        try(attachment_create(&app->msaa.color, &app->gpu_memory, app->swap_chain_image_format, app->swap_chain_extent,
+                    app->msaa.samples, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT));
+        log_info(&app->log, "msaa color %ux, %s memory", (uint32_t)app->msaa.samples, app->msaa.color.lazy ? "lazily allocated" : "device local");
+    }
+    try(attachment_create(&app->depth.attachment, &app->gpu_memory, app->depth.format, app->swap_chain_extent,
+                app->msaa.samples, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, app_depth_aspect(app)));
+    log_info(&app->log, "depth %ux, %s memory", (uint32_t)app->msaa.samples, app->depth.attachment.lazy ? "lazily allocated" : "device local");
+    log_ok(&app->log, "created attachments");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
 }
 
 int app_init_vulkan_create_framebuffers(App *app) {
     assert_arg(app);
+    if(app->features.dynamic_rendering) return 0;
     log_down(&app->log, "create %zu framebuffer", array_len(app->swap_chain_image_views));
     array_resize(app->swap_chain_framebuffers, array_len(app->swap_chain_image_views));
     for(size_t i = 0; i < array_len(app->swap_chain_image_views); ++i) {
         log_info(&app->log, "create framebuffer #%zu", i);
         VkImageView *image_view = array_it(app->swap_chain_image_views, i);
         VkFramebuffer *frame_buffer = array_it(app->swap_chain_framebuffers, i);
+        /* same order as the render pass attachments */
         VkImageView attachments[] = {
+            app->msaa.color.view ? app->msaa.color.view : *image_view,
+            app->depth.attachment.view,
             *image_view,
         };
         VkFramebufferCreateInfo framebuffer_info = {
             .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
             .renderPass = app->render_pass,
-            .attachmentCount = 1,
+            .attachmentCount = app->msaa.color.view ? 3 : 2,
             .pAttachments = attachments,
             .width = app->swap_chain_extent.width,
             .height = app->swap_chain_extent.height,
@@ -756,18 +1156,13 @@ error:
     return -1;
 }
 
-int app_init_vulkan_create_command_buffers(App *app) {
+int app_init_vulkan_create_recorder(App *app) {
     assert_arg(app);
-    log_down(&app->log, "create command buffer");
-    array_resize(app->command_buffer, APP_MAX_FRAMES_IN_FLIGHT);
-    VkCommandBufferAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = app->command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = APP_MAX_FRAMES_IN_FLIGHT,
-    };
-    try(vkAllocateCommandBuffers(app->device, &alloc_info, app->command_buffer));
-    log_ok(&app->log, "created command buffer");
+    if(!app->recorder.threads) return 0;
+    log_down(&app->log, "create recorder threads");
+    try(recorder_init(&app->recorder, app->device, app->physical.indices.graphics_family.value, app->frames_in_flight));
+    log_info(&app->log, "%zu threads, %zu command pools each", app->recorder.threads, app->frames_in_flight);
+    log_ok(&app->log, "created recorder threads");
     log_up(&app->log);
     return 0;
 error:
@@ -775,66 +1170,33 @@ error:
     return -1;
 }
 
-int record_command_buffer(VkCommandBuffer command_buffer, VkRenderPass render_pass, VkExtent2D swap_chain_extent, VkPipeline graphics_pipeline, VkFramebuffer *framebuffers, uint32_t image_index) {
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = 0, // optional
-        .pInheritanceInfo = 0, // optional
-    };
-    try(vkBeginCommandBuffer(command_buffer, &begin_info));
-    VkClearValue clear_color = {{{ 0.0f, 0.0f, 0.0f, 1.0f }}};
-    VkRenderPassBeginInfo render_pass_info = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .renderPass = render_pass,
-        .framebuffer = array_at(framebuffers, image_index),
-        .renderArea.offset = {0, 0},
-        .renderArea.extent = swap_chain_extent,
-        .clearValueCount = 1,
-        .pClearValues = &clear_color,
-    };
-    vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
-    VkViewport viewport = {
-        .x = 0.0f,
-        .y = 0.0f,
-        .width  = (float)swap_chain_extent.width,
-        .height  = (float)swap_chain_extent.height,
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f,
-    };
-    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-    VkRect2D scissor = {
-        .offset = {0, 0},
-        .extent = swap_chain_extent,
-    };
-    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
-    vkCmdDraw(command_buffer, 3, 1, 0, 0);
-    vkCmdEndRenderPass(command_buffer);
-    try(vkEndCommandBuffer(command_buffer));
+int app_init_vulkan_create_upload(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create upload queue");
+    QueueFamilyIndices *indices = &app->physical.indices;
+    try(upload_init(&app->upload, app->device, &app->gpu_memory,
+                app->transfer_queue, indices->transfer_family.value,
+                app->graphics_queue, indices->graphics_family.value,
+                UPLOAD_STAGING_SIZE));
+    if(indices->transfer_family.value != indices->graphics_family.value) {
+        log_info(&app->log, "dedicated transfer queue family %u", indices->transfer_family.value);
+    } else {
+        log_info(&app->log, "no dedicated transfer queue family, uploading on graphics");
+    }
+    log_ok(&app->log, "created upload queue");
+    log_up(&app->log);
     return 0;
 error:
+    log_up(&app->log);
     return -1;
 }
 
-int app_init_vulkan_create_sync_objects(App *app) {
+int app_init_vulkan_create_geometry(App *app) {
     assert_arg(app);
-    log_down(&app->log, "create sync objects");
-    array_resize(app->render_finished_semaphore, APP_MAX_FRAMES_IN_FLIGHT);
-    array_resize(app->image_available_semaphore, APP_MAX_FRAMES_IN_FLIGHT);
-    array_resize(app->in_flight_scene, APP_MAX_FRAMES_IN_FLIGHT);
-    VkSemaphoreCreateInfo semaphore_info = {
-        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-    };
-    VkFenceCreateInfo fence_info = {
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-    };
-    for(size_t i = 0; i < APP_MAX_FRAMES_IN_FLIGHT; ++i) {
-        try(vkCreateSemaphore(app->device, &semaphore_info, 0, array_it(app->image_available_semaphore, i)));
-        try(vkCreateSemaphore(app->device, &semaphore_info, 0, array_it(app->render_finished_semaphore, i)));
-        try(vkCreateFence(app->device, &fence_info, 0, array_it(app->in_flight_scene, i)));
-    }
-    log_ok(&app->log, "created sync objects");
+    log_down(&app->log, "create geometry");
+    try(geometry_create(&app->geometry, &app->gpu_memory, &app->upload));
+    log_info(&app->log, "%u instances, %u vertices each", app->geometry.instance_count, app->geometry.vertex_count);
+    log_ok(&app->log, "created geometry");
     log_up(&app->log);
     return 0;
 error:
@@ -842,43 +1204,952 @@ error:
     return -1;
 }
 
-void app_free_swap_chain(App *app) {
+int app_init_vulkan_create_particles(App *app) {
     assert_arg(app);
-    for(size_t i = 0; i < array_len(app->swap_chain_framebuffers); ++i) {
-        log_info(&app->log, "destroy frame buffer #%zu", i);
-        VkFramebuffer framebuffer = array_at(app->swap_chain_framebuffers, i);
-        vkDestroyFramebuffer(app->device, framebuffer, 0);
+    if(!app->particles.count) return 0;
+    log_down(&app->log, "create particles");
+    QueueFamilyIndices *indices = &app->physical.indices;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(app->physical.active, &properties);
+    uint32_t valid_bits = app_timestamp_valid_bits(app, indices->compute_family.value);
+    bool timestamps = properties.limits.timestampPeriod != 0.0f && valid_bits;
+    app->timestamps.compute_mask = valid_bits >= 64 ? UINT64_MAX : (((uint64_t)1 << valid_bits) - 1);
+    try(particles_init(&app->particles, app->device, &app->gpu_memory, &app->shaders, &app->pipeline_cache,
+                app->compute_queue, indices->compute_family.value, indices->graphics_family.value,
+                app->frames_in_flight, timestamps));
+    if(particles_async(&app->particles)) {
+        log_info(&app->log, "async compute queue family %u", indices->compute_family.value);
+    } else {
+        log_info(&app->log, "no async compute queue family, simulating on graphics");
     }
-    for(size_t i = 0; i < array_len(app->swap_chain_image_views); ++i) {
-        log_info(&app->log, "destroy image view #%zu", i);
-        VkImageView image_view = array_at(app->swap_chain_image_views, i);
+    log_info(&app->log, "%u particles, %u workgroups", app->particles.count,
+            (app->particles.count + PARTICLES_LOCAL_SIZE - 1) / PARTICLES_LOCAL_SIZE);
+    log_ok(&app->log, "created particles");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+int app_init_vulkan_create_culling(App *app) {
+    assert_arg(app);
+    if(!app->culling.enable) return 0;
+    log_down(&app->log, "create gpu culling");
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(app->physical.active, &properties);
+    if(app->geometry.instance_count > properties.limits.maxDrawIndirectCount) {
+        println("%u objects exceed maxDrawIndirectCount %u", app->geometry.instance_count, properties.limits.maxDrawIndirectCount);
+        goto error;
+    }
+    try(culling_init(&app->culling, app->device, &app->gpu_memory, &app->shaders, &app->pipeline_cache,
+                &app->geometry, app->frames_in_flight, app->culling.draw_count));
+    log_info(&app->log, "%u objects, %u workgroups, %s", app->culling.count,
+            (app->culling.count + CULLING_LOCAL_SIZE - 1) / CULLING_LOCAL_SIZE,
+            app->culling.draw_count ? "compacted with draw indirect count" : "fixed draw count");
+    log_ok(&app->log, "created gpu culling");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+static uint32_t app_min_u32(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+/* the heap is as large as the limits allow, up to BINDLESS_TEXTURES and BINDLESS_BUFFERS */
+int app_init_vulkan_create_bindless(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create bindless descriptors");
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT,
+    };
+    VkPhysicalDeviceProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = app->features.descriptor_indexing ? &indexing : 0,
+    };
+    vkGetPhysicalDeviceProperties2(app->physical.active, &properties);
+    VkPhysicalDeviceLimits *limits = &properties.properties.limits;
+    uint32_t textures = app_min_u32(limits->maxPerStageDescriptorSamplers, limits->maxPerStageDescriptorSampledImages);
+    textures = app_min_u32(textures, app_min_u32(limits->maxDescriptorSetSamplers, limits->maxDescriptorSetSampledImages));
+    uint32_t buffers = app_min_u32(limits->maxPerStageDescriptorStorageBuffers, limits->maxDescriptorSetStorageBuffers);
+    if(app->features.descriptor_indexing) {
+        textures = app_min_u32(indexing.maxPerStageDescriptorUpdateAfterBindSamplers, indexing.maxPerStageDescriptorUpdateAfterBindSampledImages);
+        textures = app_min_u32(textures, app_min_u32(indexing.maxDescriptorSetUpdateAfterBindSamplers, indexing.maxDescriptorSetUpdateAfterBindSampledImages));
+        buffers = app_min_u32(indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexing.maxDescriptorSetUpdateAfterBindStorageBuffers);
+    }
+    textures = app_min_u32(textures, BINDLESS_TEXTURES);
+    buffers = app_min_u32(buffers, BINDLESS_BUFFERS);
+    /* both arrays and the color attachment count against the fragment stage's
+     * resources, the buffers give way first */
+    uint32_t resources = app->features.descriptor_indexing ?
+        indexing.maxPerStageUpdateAfterBindResources : limits->maxPerStageResources;
+    resources = resources > 1 ? resources - 1 : 0;
+    if(textures + buffers > resources) {
+        buffers = resources > textures + 1 ? resources - textures : 1;
+        textures = resources > buffers ? resources - buffers : 1;
+    }
+    try(bindless_init(&app->bindless, app->device, textures, buffers, app->features.descriptor_indexing));
+    log_info(&app->log, "%u texture and %u buffer slots, %s", textures, buffers,
+            app->bindless.update_after_bind ? "update after bind" : "fixed once bound");
+    log_ok(&app->log, "created bindless descriptors");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+/* what every slot points to until something else is added, and the --materials tints */
+int app_init_vulkan_create_bindless_defaults(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create bindless defaults");
+    int err = 0;
+    float *tints = 0;
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .extent = { 1, 1, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    try(gpu_memory_create_image(&app->gpu_memory, &image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                &app->bindless_defaults.image, &app->bindless_defaults.allocation));
+    uint8_t white[4] = { 255, 255, 255, 255 };
+    try(upload_image(&app->upload, app->bindless_defaults.image, VK_IMAGE_ASPECT_COLOR_BIT, 0, image_info.extent, 1, white, sizeof(white)));
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = app->bindless_defaults.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = image_info.format,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = 1,
+            .layerCount = 1,
+        },
+    };
+    try(vkCreateImageView(app->device, &view_info, 0, &app->bindless_defaults.view));
+    VkSamplerCreateInfo sampler_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .maxLod = VK_LOD_CLAMP_NONE,
+    };
+    try(vkCreateSampler(app->device, &sampler_info, 0, &app->bindless_defaults.sampler));
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = sizeof(float) * 4,
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    try(gpu_memory_create_buffer(&app->gpu_memory, &buffer_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                &app->bindless_defaults.buffer, &app->bindless_defaults.buffer_allocation));
+    float tint[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    try(upload_buffer(&app->upload, app->bindless_defaults.buffer, 0, tint, sizeof(tint)));
+    try(bindless_set_defaults(&app->bindless, app->bindless_defaults.view, app->bindless_defaults.sampler, app->bindless_defaults.buffer));
+    if(app->materials.count) {
+        /* every tint at its own aligned offset of one buffer, a slot each */
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(app->physical.active, &properties);
+        VkDeviceSize align = properties.limits.minStorageBufferOffsetAlignment;
+        VkDeviceSize stride = (sizeof(tint) + align - 1) / align * align;
+        tints = calloc(app->materials.count, stride);
+        if(!tints) goto error;
+        for(uint32_t i = 0; i < app->materials.count; ++i) {
+            float *t = (float *)((unsigned char *)tints + stride * i);
+            float h = (float)i / (float)app->materials.count * 6.2831853f;
+            t[0] = 0.6f + 0.4f * cosf(h);
+            t[1] = 0.6f + 0.4f * cosf(h - 2.0943951f);
+            t[2] = 0.6f + 0.4f * cosf(h + 2.0943951f);
+            t[3] = 1.0f;
+        }
+        buffer_info.size = stride * app->materials.count;
+        try(gpu_memory_create_buffer(&app->gpu_memory, &buffer_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                    &app->materials.buffer, &app->materials.allocation));
+        try(upload_buffer(&app->upload, app->materials.buffer, 0, tints, buffer_info.size));
+        array_resize(app->materials.slots, app->materials.count);
+        for(uint32_t i = 0; i < app->materials.count; ++i) {
+            uint32_t slot = bindless_add_buffer(&app->bindless, app->materials.buffer, stride * i, sizeof(tint));
+            if(slot == BINDLESS_INVALID) goto error;
+            *array_it(app->materials.slots, i) = slot;
+        }
+        log_info(&app->log, "%u materials", app->materials.count);
+    }
+    try(upload_flush(&app->upload));
+    log_ok(&app->log, "created bindless defaults");
+clean:
+    free(tints);
+    log_up(&app->log);
+    return err;
+error:
+    err = -1;
+    goto clean;
+}
+
+int app_init_vulkan_create_frame_uniforms_layout(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create frame uniforms layout");
+    try(frame_uniforms_init(&app->frame_uniforms, app->device));
+    log_ok(&app->log, "created frame uniforms layout");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+/* a region per frame in flight, written by the cpu right before recording */
+int app_init_vulkan_create_frame_uniforms(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create frame uniforms");
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(app->physical.active, &properties);
+    try(frame_uniforms_create_buffer(&app->frame_uniforms, &app->gpu_memory, properties.limits.minUniformBufferOffsetAlignment,
+                app->frames_in_flight, FRAME_UNIFORMS_SIZE));
+    log_info(&app->log, "%zu regions of %zu bytes, aligned to %zu", array_len(app->frame_uniforms.regions),
+            (size_t)app->frame_uniforms.region, (size_t)app->frame_uniforms.alignment);
+    log_ok(&app->log, "created frame uniforms");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+/* smallest levels first, the rest streams in while rendering. without update
+ * after bind the slots are fixed once bound, so everything is loaded here */
+int app_init_vulkan_create_textures(App *app) {
+    assert_arg(app);
+    if(!array_len(app->texture_paths)) return 0;
+    log_down(&app->log, "create textures");
+    textures_init(&app->textures, app->device, app->physical.active, &app->gpu_memory, &app->upload,
+            &app->bindless, &app->deletion_queue, app->bindless_defaults.sampler);
+    for(size_t i = 0; i < array_len(app->texture_paths); ++i) {
+        try(textures_load(&app->textures, array_at(app->texture_paths, i)));
+        Texture *texture = array_it(app->textures.textures, i);
+        log_info(&app->log, "%s: %ux%u, %u levels%s", texture->path, texture->file.extent.width, texture->file.extent.height,
+                texture->levels, texture->decode ? ", decoded on the cpu" : "");
+    }
+    if(app->bindless.update_after_bind) {
+        try(textures_stream(&app->textures, TEXTURES_STREAM_BUDGET));
+    } else {
+        try(textures_stream(&app->textures, UINT64_MAX));
+        /* the last batch textures_stream flushed */
+        try(upload_wait(&app->upload, upload_ticket(&app->upload) - 1));
+        bool changed = false;
+        try(textures_update(&app->textures, 0, &changed));
+    }
+    log_ok(&app->log, "created textures");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+int app_init_vulkan_create_command_buffers(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create command buffer");
+    array_resize(app->command_buffer, app->frames_in_flight);
+    VkCommandBufferAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = app->command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = app->frames_in_flight,
+    };
+    try(vkAllocateCommandBuffers(app->device, &alloc_info, app->command_buffer));
+    log_ok(&app->log, "created command buffer");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+int app_reserve_query_pools(App *app, size_t count);
+
+/* one per frame in flight, the overdraw scene never caches its commands */
+int app_init_vulkan_create_statistics_pools(App *app) {
+    assert_arg(app);
+    if(!app->features.pipeline_statistics) return 0;
+    array_resize(app->statistics.pool, app->frames_in_flight);
+    array_resize(app->statistics.pending, app->frames_in_flight);
+    VkQueryPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount = 1,
+        .pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT,
+    };
+    for(size_t i = 0; i < app->frames_in_flight; ++i) {
+        *array_it(app->statistics.pool, i) = VK_NULL_HANDLE;
+        *array_it(app->statistics.pending, i) = false;
+    }
+    for(size_t i = 0; i < app->frames_in_flight; ++i) {
+        try(vkCreateQueryPool(app->device, &pool_info, 0, array_it(app->statistics.pool, i)));
+    }
+    log_info(&app->log, "created %zu pipeline statistics query pools", app->frames_in_flight);
+    return 0;
+error:
+    return -1;
+}
+
+VkQueryPool app_statistics_pool(App *app, size_t slot) {
+    assert_arg(app);
+    if(slot >= array_len(app->statistics.pool)) return VK_NULL_HANDLE;
+    return array_at(app->statistics.pool, slot);
+}
+
+void app_read_statistics(App *app, size_t slot) {
+    assert_arg(app);
+    if(slot >= array_len(app->statistics.pool)) return;
+    bool *pending = array_it(app->statistics.pending, slot);
+    if(!*pending) return;
+    uint64_t invocations = 0;
+    VkQueryPool pool = array_at(app->statistics.pool, slot);
+    VkResult result = vkGetQueryPoolResults(app->device, pool, 0, 1, sizeof(invocations), &invocations, sizeof(invocations), VK_QUERY_RESULT_64_BIT);
+    *pending = false;
+    if(result != VK_SUCCESS) return;
+    app->statistics.fragments += (double)invocations;
+    ++app->statistics.frames;
+}
+
+double app_fragments_per_pixel(App *app) {
+    assert_arg(app);
+    double pixels = (double)app->swap_chain_extent.width * (double)app->swap_chain_extent.height;
+    if(!app->statistics.frames || !pixels) return 0.0;
+    return app->statistics.fragments / (double)app->statistics.frames / pixels;
+}
+
+uint32_t app_timestamp_valid_bits(App *app, uint32_t queue_family) {
+    assert_arg(app);
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(app->physical.active, &queue_family_count, 0);
+    VkQueueFamilyProperties *queue_families = {0};
+    array_resize(queue_families, queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(app->physical.active, &queue_family_count, queue_families);
+    uint32_t valid_bits = array_at(queue_families, queue_family).timestampValidBits;
+    array_free(queue_families);
+    return valid_bits;
+}
+
+int app_init_vulkan_create_query_pools(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create timestamp query pools");
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(app->physical.active, &properties);
+    uint32_t valid_bits = app_timestamp_valid_bits(app, app->physical.indices.graphics_family.value);
+    if(!valid_bits || properties.limits.timestampPeriod == 0.0f) {
+        log_info(&app->log, "timestamps not supported on graphics queue");
+        try(app_init_vulkan_create_statistics_pools(app));
+        log_up(&app->log);
+        return 0;
+    }
+    app->timestamps.period = (double)properties.limits.timestampPeriod;
+    app->timestamps.mask = valid_bits >= 64 ? UINT64_MAX : (((uint64_t)1 << valid_bits) - 1);
+    try(app_reserve_query_pools(app, app->frames_in_flight));
+    log_ok(&app->log, "created timestamp query pools");
+    try(app_init_vulkan_create_statistics_pools(app));
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+int app_reserve_query_pools(App *app, size_t count) {
+    assert_arg(app);
+    if(!app->timestamps.period) return 0;
+    size_t len = array_len(app->timestamps.pool);
+    if(count <= len) return 0;
+    array_resize(app->timestamps.pool, count);
+    array_resize(app->timestamps.frame, count);
+    array_resize(app->timestamps.pending, count);
+    VkQueryPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2,
+    };
+    for(size_t i = len; i < count; ++i) {
+        *array_it(app->timestamps.pool, i) = VK_NULL_HANDLE;
+        *array_it(app->timestamps.frame, i) = 0;
+        *array_it(app->timestamps.pending, i) = false;
+    }
+    for(size_t i = len; i < count; ++i) {
+        try(vkCreateQueryPool(app->device, &pool_info, 0, array_it(app->timestamps.pool, i)));
+    }
+    return 0;
+error:
+    return -1;
+}
+
+VkQueryPool app_query_pool(App *app, size_t slot) {
+    assert_arg(app);
+    if(slot >= array_len(app->timestamps.pool)) return VK_NULL_HANDLE;
+    return array_at(app->timestamps.pool, slot);
+}
+
+void app_read_timestamps(App *app, size_t slot) {
+    assert_arg(app);
+    if(slot >= array_len(app->timestamps.pool)) return;
+    bool *pending = array_it(app->timestamps.pending, slot);
+    if(!*pending) return;
+    /* the last frame using this slot was waited on, so this does not stall */
+    uint64_t ticks[2];
+    VkQueryPool pool = array_at(app->timestamps.pool, slot);
+    VkResult result = vkGetQueryPoolResults(app->device, pool, 0, 2, sizeof(ticks), ticks, sizeof(*ticks), VK_QUERY_RESULT_64_BIT);
+    *pending = false;
+    if(result != VK_SUCCESS) return;
+    double ms = (double)((ticks[1] - ticks[0]) & app->timestamps.mask) * app->timestamps.period / 1e6;
+    frame_stats_set(&app->stats, array_at(app->timestamps.frame, slot), FRAME_STAT_GPU, ms);
+    app->timestamps.last[0] = ticks[0];
+    app->timestamps.last[1] = ticks[1];
+    app->timestamps.last_frame = array_at(app->timestamps.frame, slot);
+    app->timestamps.last_valid = true;
+}
+
+/* the particle step of the slot about to be reused, before app_read_timestamps
+ * replaces the ticks of the frame before it. step N overlaps frame N - 1 */
+void app_read_compute_timestamps(App *app, size_t slot) {
+    assert_arg(app);
+    if(!app->particles.count || !app->timestamps.period) return;
+    size_t frame = 0;
+    uint64_t ticks[2];
+    if(!particles_read_timestamps(&app->particles, slot, &frame, ticks)) return;
+    double ms = (double)((ticks[1] - ticks[0]) & app->timestamps.compute_mask) * app->timestamps.period / 1e6;
+    frame_stats_set(&app->stats, frame, FRAME_STAT_COMPUTE, ms);
+    if(!app->timestamps.last_valid || app->timestamps.last_frame + 1 != frame) return;
+    uint64_t begin = ticks[0] > app->timestamps.last[0] ? ticks[0] : app->timestamps.last[0];
+    uint64_t end = ticks[1] < app->timestamps.last[1] ? ticks[1] : app->timestamps.last[1];
+    double overlap = end > begin ? (double)(end - begin) * app->timestamps.period / 1e6 : 0.0;
+    frame_stats_set(&app->stats, frame, FRAME_STAT_OVERLAP, overlap);
+}
+
+/* where a frame is drawn: a framebuffer of the render pass, or the image itself with dynamic rendering */
+typedef struct AppTarget {
+    VkRenderPass render_pass;
+    VkFramebuffer framebuffer;
+    VkImage image;
+    VkImageView view;
+    VkImage msaa_image;         // VK_NULL_HANDLE without msaa, resolved into image
+    VkImageView msaa_view;
+    VkImage depth_image;        // shared by every frame, cleared and never stored
+    VkImageView depth_view;
+    VkImageAspectFlags depth_aspect;
+    VkExtent2D extent;
+    VkImageLayout final_layout;
+} AppTarget;
+
+AppTarget app_target(App *app, uint32_t image_index) {
+    assert_arg(app);
+    AppTarget target = {
+        .render_pass = app->render_pass,
+        .image = array_at(app->swap_chain_images, image_index),
+        .view = array_at(app->swap_chain_image_views, image_index),
+        .msaa_image = app->msaa.color.image,
+        .msaa_view = app->msaa.color.view,
+        .depth_image = app->depth.attachment.image,
+        .depth_view = app->depth.attachment.view,
+        .depth_aspect = app_depth_aspect(app),
+        .extent = app->swap_chain_extent,
+        .final_layout = app->display == APP_DISPLAY_OFFSCREEN ?
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+    };
+    if(app->render_pass) {
+        target.framebuffer = array_at(app->swap_chain_framebuffers, image_index);
+    }
+    return target;
+}
+
+void app_barrier_target(App *app, VkCommandBuffer command_buffer, AppTarget *target, bool begin) {
+    assert_arg(app);
+    assert_arg(target);
+    VkImageMemoryBarrier2KHR barriers[3];
+    uint32_t count = 0;
+    VkImageMemoryBarrier2KHR barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = target->image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = 1,
+            .layerCount = 1,
+        },
+    };
+    if(begin) {
+        /* same as the render pass' external dependency: wait for the acquire semaphore's stage */
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
+        barrier.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barriers[count++] = barrier;
+        if(target->msaa_image) {
+            /* shared by every frame, the previous frame's writes have to finish first */
+            barrier.image = target->msaa_image;
+            barrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR;
+            barriers[count++] = barrier;
+        }
+        /* the contents are cleared, only the previous frame's depth writes have to finish */
+        barrier.image = target->depth_image;
+        barrier.subresourceRange.aspectMask = target->depth_aspect;
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR;
+        barrier.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR;
+        barrier.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR;
+        barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        barriers[count++] = barrier;
+    } else {
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
+        barrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.newLayout = target->final_layout;
+        if(target->final_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT_KHR;
+            barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT_KHR;
+        } else {
+            /* the present waits on the render finished semaphore */
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE_KHR;
+        }
+        barriers[count++] = barrier;
+    }
+    VkDependencyInfoKHR dependency = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+        .imageMemoryBarrierCount = count,
+        .pImageMemoryBarriers = barriers,
+    };
+    app->rendering.barrier(command_buffer, &dependency);
+}
+
+void app_begin_target(App *app, VkCommandBuffer command_buffer, AppTarget *target, bool secondaries) {
+    assert_arg(app);
+    assert_arg(target);
+    VkClearValue clear_color = {{{ 0.0f, 0.0f, 0.0f, 1.0f }}};
+    VkClearValue clear_depth = { .depthStencil = { 1.0f, 0 } };
+    if(target->render_pass) {
+        /* by attachment, the resolve attachment is not cleared */
+        VkClearValue clear_values[] = {
+            clear_color,
+            clear_depth,
+        };
+        VkRenderPassBeginInfo render_pass_info = {
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass = target->render_pass,
+            .framebuffer = target->framebuffer,
+            .renderArea.offset = {0, 0},
+            .renderArea.extent = target->extent,
+            .clearValueCount = 2,
+            .pClearValues = clear_values,
+        };
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info,
+                secondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
+    app_barrier_target(app, command_buffer, target, true);
+    VkRenderingAttachmentInfoKHR color_attachment = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+        .imageView = target->view,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = clear_color,
+    };
+    if(target->msaa_view) {
+        /* draw into the transient target, resolve into the image, never store the samples */
+        color_attachment.imageView = target->msaa_view;
+        color_attachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT_KHR;
+        color_attachment.resolveImageView = target->view;
+        color_attachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    }
+    VkRenderingAttachmentInfoKHR depth_attachment = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+        .imageView = target->depth_view,
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .clearValue = clear_depth,
+    };
+    VkRenderingInfoKHR rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+        .flags = secondaries ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0,
+        .renderArea.offset = {0, 0},
+        .renderArea.extent = target->extent,
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_attachment,
+        .pDepthAttachment = &depth_attachment,
+    };
+    app->rendering.begin(command_buffer, &rendering_info);
+}
+
+void app_end_target(App *app, VkCommandBuffer command_buffer, AppTarget *target) {
+    assert_arg(app);
+    assert_arg(target);
+    if(target->render_pass) {
+        vkCmdEndRenderPass(command_buffer);
+        return;
+    }
+    app->rendering.end(command_buffer);
+    app_barrier_target(app, command_buffer, target, false);
+}
+
+static float app_camera_zoom(App *app) {
+    return app->camera.zoom > 0.0f ? app->camera.zoom : 1.0f;
+}
+
+/* the area the camera sees, in the space of the instance offsets */
+void app_camera_frustum(App *app, float frustum[4]) {
+    assert_arg(app);
+    float half = 1.0f / app_camera_zoom(app);
+    frustum[0] = app->camera.x - half;
+    frustum[1] = app->camera.y - half;
+    frustum[2] = app->camera.x + half;
+    frustum[3] = app->camera.y + half;
+}
+
+void app_frame_data(App *app, FrameData *data) {
+    assert_arg(app);
+    assert_arg(data);
+    double now = frame_stats_now();
+    if(!app->frame_data.start) {
+        app->frame_data.start = now;
+        app->frame_data.last = now;
+    }
+    *data = (FrameData){
+        .view = { app->camera.x, app->camera.y, app_camera_zoom(app), 0.0f },
+        .time = { (float)(now - app->frame_data.start), (float)(now - app->frame_data.last), (float)app->frame_count, 0.0f },
+    };
+    app->frame_data.last = now;
+}
+
+int record_command_buffer(App *app, VkCommandBuffer command_buffer, AppTarget *target, VkPipeline graphics_pipeline, VkCommandBuffer *secondaries, VkQueryPool query_pool, VkQueryPool statistics_pool) {
+    assert_arg(app);
+    assert_arg(target);
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = 0, // optional
+        .pInheritanceInfo = 0, // optional
+    };
+    try(vkBeginCommandBuffer(command_buffer, &begin_info));
+    if(query_pool) {
+        vkCmdResetQueryPool(command_buffer, query_pool, 0, 2);
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+    }
+    if(array_len(secondaries)) {
+        /* the draws were recorded by the worker threads, each binding the bindless set */
+        app->bindless.bound = true;
+        app_begin_target(app, command_buffer, target, true);
+        vkCmdExecuteCommands(command_buffer, array_len(secondaries), secondaries);
+        app_end_target(app, command_buffer, target);
+        goto done;
+    }
+    if(app->culling.enable) {
+        float frustum[4];
+        app_camera_frustum(app, frustum);
+        culling_dispatch(&app->culling, command_buffer, app->current_frame, frustum);
+    }
+    /* secondaries would need inherited queries, the overdraw scene is counted inline only */
+    if(statistics_pool) {
+        vkCmdResetQueryPool(command_buffer, statistics_pool, 0, 1);
+        vkCmdBeginQuery(command_buffer, statistics_pool, 0, 0);
+    }
+    app_begin_target(app, command_buffer, target, false);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+    /* once per command buffer, no matter how many materials are drawn */
+    bindless_bind(&app->bindless, command_buffer, app->pipeline_layout);
+    frame_uniforms_bind(&app->frame_uniforms, command_buffer, app->pipeline_layout, 1, app->frame_data.offset);
+    VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width  = (float)target->extent.width,
+        .height  = (float)target->extent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    VkRect2D scissor = {
+        .offset = {0, 0},
+        .extent = target->extent,
+    };
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    /* the first --texture, as far as it is resident */
+    BindlessPush push = {
+        .texture = textures_slot(&app->textures, 0),
+        .material = BINDLESS_DEFAULT,
+    };
+    if(app->culling.enable) {
+        vkCmdPushConstants(command_buffer, app->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+        culling_draw(&app->culling, command_buffer, app->current_frame);
+    } else {
+        geometry_draw_materials(&app->geometry, command_buffer, app->pipeline_layout, 0, app->geometry.instance_count,
+                push.texture, app->materials.slots, app->materials.count);
+    }
+    if(app->particles.count) {
+        push.texture = BINDLESS_DEFAULT;
+        vkCmdPushConstants(command_buffer, app->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+        geometry_draw_instances(&app->geometry, command_buffer, particles_buffer(&app->particles, app->frame_count), app->particles.count);
+    }
+    app_end_target(app, command_buffer, target);
+    if(statistics_pool) {
+        vkCmdEndQuery(command_buffer, statistics_pool, 0);
+    }
+done:
+    if(query_pool) {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+    }
+    try(vkEndCommandBuffer(command_buffer));
+    return 0;
+error:
+    return -1;
+}
+
+void app_free_cached_commands(App *app) {
+    assert_arg(app);
+    if(array_len(app->cached_commands.buffers)) {
+        vkFreeCommandBuffers(app->device, app->command_pool, array_len(app->cached_commands.buffers), app->cached_commands.buffers);
+    }
+    array_free(app->cached_commands.buffers);
+    array_free(app->cached_commands.images_in_flight);
+}
+
+int app_record_cached_commands(App *app) {
+    assert_arg(app);
+    size_t count = array_len(app->swap_chain_image_views);
+    /* the old buffers may still be pending, free them once their frame completed */
+    for(size_t i = 0; i < array_len(app->cached_commands.buffers); ++i) {
+        deletion_queue_push(&app->deletion_queue, (DeletionEntry){
+            .kind = DELETION_COMMAND_BUFFER,
+            .frame = app->frame_count,
+            .command_buffer.pool = app->command_pool,
+            .command_buffer.buffer = array_at(app->cached_commands.buffers, i),
+        });
+    }
+    array_clear(app->cached_commands.buffers);
+    /* the new buffers reset and write the query pools of the old ones, so
+     * slot i keeps waiting on the frame that last submitted the old buffer i */
+    uint64_t *in_flight = app->cached_commands.images_in_flight;
+    app->cached_commands.images_in_flight = 0;
+    app_free_cached_commands(app);
+    array_resize(app->cached_commands.images_in_flight, count);
+    for(size_t i = 0; i < count; ++i) {
+        *array_it(app->cached_commands.images_in_flight, i) = i < array_len(in_flight) ? array_at(in_flight, i) : 0;
+    }
+    array_free(in_flight);
+    try(app_reserve_query_pools(app, count));
+    array_resize(app->cached_commands.buffers, count);
+    VkCommandBufferAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = app->command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = count,
+    };
+    if(vkAllocateCommandBuffers(app->device, &alloc_info, app->cached_commands.buffers)) {
+        array_free(app->cached_commands.buffers);
+        THROW("failed to allocate cached command buffers!");
+    }
+    /* replayed every frame, so the data can't change and doesn't need a ring */
+    if(!app->cached_commands.frame_written) {
+        FrameData data;
+        app_frame_data(app, &data);
+        try(frame_uniforms_push_static(&app->frame_uniforms, &data, sizeof(data), &app->frame_data.offset));
+        app->cached_commands.frame_written = true;
+    }
+    for(size_t i = 0; i < count; ++i) {
+        AppTarget target = app_target(app, (uint32_t)i);
+        try(record_command_buffer(app, array_at(app->cached_commands.buffers, i), &target, app->pipeline_bound, 0, app_query_pool(app, i), VK_NULL_HANDLE));
+    }
+    app->cached_commands.dirty = false;
+    return 0;
+error:
+    return -1;
+}
+
+int app_init_vulkan_create_sync_objects(App *app) {
+    assert_arg(app);
+    log_down(&app->log, "create sync objects");
+    array_resize(app->render_finished_semaphore, app->frames_in_flight);
+    array_resize(app->image_available_semaphore, app->frames_in_flight);
+    VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+    for(size_t i = 0; i < app->frames_in_flight; ++i) {
+        try(vkCreateSemaphore(app->device, &semaphore_info, 0, array_it(app->image_available_semaphore, i)));
+        try(vkCreateSemaphore(app->device, &semaphore_info, 0, array_it(app->render_finished_semaphore, i)));
+    }
+    log_info(&app->log, "create frame timeline");
+    VkSemaphoreTypeCreateInfoKHR type_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+        .initialValue = 0,
+    };
+    VkSemaphoreCreateInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+    };
+    try(vkCreateSemaphore(app->device, &timeline_info, 0, &app->timeline.semaphore));
+    log_ok(&app->log, "created sync objects");
+    log_up(&app->log);
+    return 0;
+error:
+    log_up(&app->log);
+    return -1;
+}
+
+void app_free_swap_chain(App *app) {
+    assert_arg(app);
+    for(size_t i = 0; i < array_len(app->swap_chain_framebuffers); ++i) {
+        log_info(&app->log, "destroy frame buffer #%zu", i);
+        VkFramebuffer framebuffer = array_at(app->swap_chain_framebuffers, i);
+        vkDestroyFramebuffer(app->device, framebuffer, 0);
+    }
+    for(size_t i = 0; i < array_len(app->swap_chain_image_views); ++i) {
+        log_info(&app->log, "destroy image view #%zu", i);
+        VkImageView image_view = array_at(app->swap_chain_image_views, i);
         vkDestroyImageView(app->device, image_view, 0);
     }
     if(app->swap_chain) {
         log_info(&app->log, "destroy swapchain");
         vkDestroySwapchainKHR(app->device, app->swap_chain, 0);
     }
+    for(size_t i = 0; i < array_len(app->offscreen.allocations); ++i) {
+        log_info(&app->log, "destroy offscreen image #%zu", i);
+        gpu_memory_destroy_image(&app->gpu_memory, array_at(app->swap_chain_images, i), array_it(app->offscreen.allocations, i));
+    }
+    array_free(app->offscreen.allocations);
+    array_free(app->swap_chain_framebuffers);
+    if(app->msaa.color.image) {
+        log_info(&app->log, "destroy msaa color attachment");
+        attachment_destroy(&app->msaa.color, &app->gpu_memory);
+    }
+    if(app->depth.attachment.image) {
+        log_info(&app->log, "destroy depth attachment");
+        attachment_destroy(&app->depth.attachment, &app->gpu_memory);
+    }
+}
+
+void app_retire_attachment(App *app, Attachment *attachment) {
+    assert_arg(app);
+    assert_arg(attachment);
+    if(!attachment->image) return;
+    deletion_queue_push(&app->deletion_queue, (DeletionEntry){
+        .kind = DELETION_IMAGE_VIEW,
+        .frame = app->frame_count,
+        .image_view = attachment->view,
+    });
+    deletion_queue_push(&app->deletion_queue, (DeletionEntry){
+        .kind = DELETION_IMAGE,
+        .frame = app->frame_count,
+        .image.image = attachment->image,
+        .image.allocation = attachment->allocation,
+    });
+    memset(attachment, 0, sizeof(*attachment));
+}
+
+void app_retire_swap_chain(App *app) {
+    assert_arg(app);
+    for(size_t i = 0; i < array_len(app->swap_chain_framebuffers); ++i) {
+        deletion_queue_push(&app->deletion_queue, (DeletionEntry){
+            .kind = DELETION_FRAMEBUFFER,
+            .frame = app->frame_count,
+            .framebuffer = array_at(app->swap_chain_framebuffers, i),
+        });
+    }
+    for(size_t i = 0; i < array_len(app->swap_chain_image_views); ++i) {
+        deletion_queue_push(&app->deletion_queue, (DeletionEntry){
+            .kind = DELETION_IMAGE_VIEW,
+            .frame = app->frame_count,
+            .image_view = array_at(app->swap_chain_image_views, i),
+        });
+    }
+    app_retire_attachment(app, &app->msaa.color);
+    app_retire_attachment(app, &app->depth.attachment);
+    /* offscreen the images are ours, a swap chain's go with the swap chain */
+    for(size_t i = 0; i < array_len(app->offscreen.allocations); ++i) {
+        deletion_queue_push(&app->deletion_queue, (DeletionEntry){
+            .kind = DELETION_IMAGE,
+            .frame = app->frame_count,
+            .image.image = array_at(app->swap_chain_images, i),
+            .image.allocation = array_at(app->offscreen.allocations, i),
+        });
+    }
+    array_free(app->offscreen.allocations);
     array_free(app->swap_chain_framebuffers);
+    array_free(app->swap_chain_image_views);
 }
 
 int app_init_vulkan_recreate_swap_chain(App *app) {
     assert_arg(app);
     int width = 0, height = 0;
-    glfwGetFramebufferSize(app->window, &width, &height);
-    while(width == 0 || height == 0) {
+    if(app->window) {
         glfwGetFramebufferSize(app->window, &width, &height);
-        glfwWaitEvents();
+        while(width == 0 || height == 0) {
+            glfwGetFramebufferSize(app->window, &width, &height);
+            glfwWaitEvents();
+        }
     }
-    vkDeviceWaitIdle(app->device);
-    app_free_swap_chain(app);
+    /* no device wait: old objects are retired and destroyed frames_in_flight frames later */
+    double t0 = frame_stats_now();
+    app_retire_swap_chain(app);
+    pacing_present_reset(&app->pacing);
     try(app_init_vulkan_create_swap_chain(app));
     try(app_init_vulkan_create_image_views(app));
+    try(app_init_vulkan_create_attachments(app));
     try(app_init_vulkan_create_framebuffers(app));
+    app->cached_commands.dirty = true;
+    app->framebuffer_resized = false;
+    app->swap_chain_recreate = false;
+    frame_stats_set(&app->stats, app->stats.frames - 1, FRAME_STAT_RECREATE, (frame_stats_now() - t0) * 1e3);
     return 0;
 error:
     return -1;
 }
 
+bool app_swap_chain_needs_recreate(App *app, VkResult present_result) {
+    assert_arg(app);
+    if(present_result == VK_ERROR_OUT_OF_DATE_KHR) return true;
+    if(app->swap_chain_recreate) return true;
+    if(present_result != VK_SUBOPTIMAL_KHR && !app->framebuffer_resized) return false;
+    /* coalesce a burst of resize events into one recreation once the size settled */
+    if(frame_stats_now() - app->framebuffer_resized_at < APP_RESIZE_SETTLE_SEC) return false;
+    if(app->window && present_result != VK_SUBOPTIMAL_KHR) {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(app->window, &width, &height);
+        if((uint32_t)width == app->swap_chain_extent.width && (uint32_t)height == app->swap_chain_extent.height) {
+            app->framebuffer_resized = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void app_log_startup(App *app) { /*{{{*/
+    assert_arg(app);
+    Startup *startup = &app->startup;
+    double work = 0;
+    for(size_t i = 0; i < array_len(startup->steps); ++i) {
+        StartupStep *step = array_it(startup->steps, i);
+        if(step->state != STARTUP_DONE && step->state != STARTUP_FAILED) continue;
+        work += step->end - step->begin;
+        log_info(&app->log, "%-18s %8.3fms at %8.3fms on thread %d", step->name,
+                (step->end - step->begin) * 1e3, step->begin * 1e3, step->thread);
+    }
+    log_info(&app->log, "%.3fms wall, %.3fms of work on %zu threads, critical path %.3fms",
+            startup->wall * 1e3, work * 1e3, startup->threads + 1, startup_critical_path(startup) * 1e3);
+} /*}}}*/
 
 int app_init_vulkan(App *app) { /*{{{*/
     assert_arg(app);
@@ -886,19 +2157,47 @@ int app_init_vulkan(App *app) { /*{{{*/
     if(app->validation.enable) {
         array_push(app->validation.layers, "VK_LAYER_KHRONOS_validation");
     }
-    try(app_init_vulkan_create_instance(app));
-    try(app_init_vulkan_setup_debug_messenger(app));
-    try(app_init_vulkan_create_surface(app));
-    try(app_init_vulkan_pick_physical_device(app));
-    try(app_init_vulkan_create_logical_device(app));
-    try(app_init_vulkan_create_swap_chain(app));
-    try(app_init_vulkan_create_image_views(app));
-    try(app_init_vulkan_create_render_pass(app));
-    try(app_init_vulkan_create_graphics_pipeline(app));
-    try(app_init_vulkan_create_framebuffers(app));
-    try(app_init_vulkan_create_command_pool(app));
-    try(app_init_vulkan_create_command_buffers(app));
-    try(app_init_vulkan_create_sync_objects(app));
+    array_push(app->device_extensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    /* independent steps run in parallel. glfw wants the window on the main
+     * thread, the gpu memory allocator is not thread safe so its users are
+     * chained: swap chain (offscreen images) -> attachments -> upload -> geometry -> particles */
+    Startup *startup = &app->startup;
+    startup->threads = app->serial_startup ? 0 : STARTUP_THREADS;
+    startup->log = &app->log;
+    bool window = app->display == APP_DISPLAY_WINDOW;
+    size_t create_window = startup_add(startup, "window", app_init_glfw_create_window, true, STARTUP_END);
+    size_t instance = startup_add(startup, "instance", app_init_vulkan_create_instance, false, STARTUP_END);
+    startup_add(startup, "debug messenger", app_init_vulkan_setup_debug_messenger, false, instance, STARTUP_END);
+    size_t surface = startup_add(startup, "surface", app_init_vulkan_create_surface, false, instance, create_window, STARTUP_END);
+    size_t physical = startup_add(startup, "physical device", app_init_vulkan_pick_physical_device, false, surface, STARTUP_END);
+    size_t device = startup_add(startup, "logical device", app_init_vulkan_create_logical_device, false, physical, STARTUP_END);
+    size_t shader_modules = startup_add(startup, "shader modules", app_init_vulkan_create_shader_modules, false, device, STARTUP_END);
+    size_t pipeline_cache = startup_add(startup, "pipeline cache", app_init_vulkan_create_pipeline_cache, false, device, STARTUP_END);
+    size_t swap_chain = startup_add(startup, "swap chain", app_init_vulkan_create_swap_chain, window, device, STARTUP_END);
+    size_t image_views = startup_add(startup, "image views", app_init_vulkan_create_image_views, false, swap_chain, STARTUP_END);
+    size_t attachments = startup_add(startup, "attachments", app_init_vulkan_create_attachments, false, swap_chain, STARTUP_END);
+    size_t render_pass = startup_add(startup, "render pass", app_init_vulkan_create_render_pass, false, swap_chain, STARTUP_END);
+    size_t bindless = startup_add(startup, "bindless", app_init_vulkan_create_bindless, false, device, STARTUP_END);
+    size_t frame_uniforms = startup_add(startup, "frame uniforms layout", app_init_vulkan_create_frame_uniforms_layout, false, device, STARTUP_END);
+    startup_add(startup, "graphics pipeline", app_init_vulkan_create_graphics_pipeline, false, render_pass, shader_modules, pipeline_cache, bindless, frame_uniforms, STARTUP_END);
+    startup_add(startup, "framebuffers", app_init_vulkan_create_framebuffers, false, render_pass, image_views, attachments, STARTUP_END);
+    size_t command_pool = startup_add(startup, "command pool", app_init_vulkan_create_command_pool, false, device, STARTUP_END);
+    startup_add(startup, "command buffers", app_init_vulkan_create_command_buffers, false, command_pool, STARTUP_END);
+    startup_add(startup, "recorder", app_init_vulkan_create_recorder, false, device, STARTUP_END);
+    size_t upload = startup_add(startup, "upload", app_init_vulkan_create_upload, false, attachments, STARTUP_END);
+    size_t geometry = startup_add(startup, "geometry", app_init_vulkan_create_geometry, false, upload, STARTUP_END);
+    size_t particles = startup_add(startup, "particles", app_init_vulkan_create_particles, false, geometry, shader_modules, pipeline_cache, STARTUP_END);
+    size_t culling = startup_add(startup, "culling", app_init_vulkan_create_culling, false, particles, STARTUP_END);
+    size_t bindless_defaults = startup_add(startup, "bindless defaults", app_init_vulkan_create_bindless_defaults, false, culling, bindless, STARTUP_END);
+    size_t frame_uniforms_buffer = startup_add(startup, "frame uniforms", app_init_vulkan_create_frame_uniforms, false, bindless_defaults, frame_uniforms, STARTUP_END);
+    startup_add(startup, "textures", app_init_vulkan_create_textures, false, frame_uniforms_buffer, STARTUP_END);
+    startup_add(startup, "sync objects", app_init_vulkan_create_sync_objects, false, device, STARTUP_END);
+    startup_add(startup, "query pools", app_init_vulkan_create_query_pools, false, device, STARTUP_END);
+    int err = startup_run(startup, app);
+    app_log_startup(app);
+    if(err) goto error;
+    app->cached_commands.dirty = true;
+    app_log_gpu_memory(app);
     log_ok(&app->log, "initialized vulkan");
     log_up(&app->log);
     return 0;
@@ -911,9 +2210,13 @@ int app_init(App *app) { /*{{{*/
     assert_arg(app);
     assert_arg(app->name);
     assert_arg(app->engine);
-    array_push(app->device_extensions, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     log_start(&app->log);
-    try(app_init_glfw(app));
+    frame_stats_init(&app->stats, app->stats.capacity);
+    if(!app->frames_in_flight) app->frames_in_flight = APP_FRAMES_IN_FLIGHT;
+    if(app->frames_in_flight > APP_MAX_FRAMES_IN_FLIGHT) THROW("too many frames in flight");
+    if(app->display == APP_DISPLAY_WINDOW) {
+        try(app_init_glfw(app));
+    }
     try(app_init_vulkan(app));
     log_output(&app->log, false);
     return 0;
@@ -928,6 +2231,9 @@ void app_free(App *app) { /*{{{*/
     log_output(&app->log, true);
     assert_arg(app);
     log_down(&app->log, "clean up");
+    log_info(&app->log, "destroy %zu retired objects", array_len(app->deletion_queue.entries));
+    deletion_queue_flush_all(&app->deletion_queue, app->device);
+    deletion_queue_free(&app->deletion_queue);
     app_free_swap_chain(app);
     for(size_t i = 0; i < array_len(app->image_available_semaphore); ++i) {
         log_info(&app->log, "destroy a semaphore available");
@@ -937,17 +2243,45 @@ void app_free(App *app) { /*{{{*/
         log_info(&app->log, "destroy a semaphore render");
         vkDestroySemaphore(app->device, array_at(app->render_finished_semaphore, i), 0);
     }
-    for(size_t i = 0; i < array_len(app->in_flight_scene); ++i) {
-        log_info(&app->log, "destroy a fence");
-        vkDestroyFence(app->device, array_at(app->in_flight_scene, i), 0);
+    if(app->timeline.semaphore) {
+        log_info(&app->log, "destroy frame timeline");
+        vkDestroySemaphore(app->device, app->timeline.semaphore, 0);
+    }
+    for(size_t i = 0; i < array_len(app->timestamps.pool); ++i) {
+        log_info(&app->log, "destroy a query pool");
+        vkDestroyQueryPool(app->device, array_at(app->timestamps.pool, i), 0);
+    }
+    for(size_t i = 0; i < array_len(app->statistics.pool); ++i) {
+        log_info(&app->log, "destroy a statistics query pool");
+        vkDestroyQueryPool(app->device, array_at(app->statistics.pool, i), 0);
+    }
+    app_free_cached_commands(app);
+    if(app->recorder.device) {
+        log_info(&app->log, "stop recorder threads");
+        recorder_free(&app->recorder);
     }
     if(app->command_pool) {
         log_info(&app->log, "destroy command pool");
         vkDestroyCommandPool(app->device, app->command_pool, 0);
     }
-    if(app->graphics_pipeline) {
-        log_info(&app->log, "destroy graphics pipeline");
-        vkDestroyPipeline(app->device, app->graphics_pipeline, 0);
+    if(app->variants.device) {
+        log_info(&app->log, "destroy %zu pipeline variants (%zu hits, %zu fallbacks)",
+                pipeline_variants_count(&app->variants), app->variants.hits, app->variants.fallbacks);
+        pipeline_variants_free(&app->variants);
+    }
+    if(app->pipeline_cache.cache) {
+        log_info(&app->log, "save pipeline cache '%s' (%zu hits, %zu misses)", app->pipeline_cache.path,
+                app->pipeline_cache.hits, app->pipeline_cache.misses);
+        if(pipeline_cache_save(&app->pipeline_cache, app->physical.active, app->device)) {
+            log_info(&app->log, "failed to save pipeline cache");
+        }
+        log_info(&app->log, "destroy pipeline cache");
+        pipeline_cache_destroy(&app->pipeline_cache, app->device);
+    }
+    if(app->shader_modules.vert || app->shader_modules.frag) {
+        log_info(&app->log, "destroy shader modules");
+        vkDestroyShaderModule(app->device, app->shader_modules.vert, 0);
+        vkDestroyShaderModule(app->device, app->shader_modules.frag, 0);
     }
     if(app->pipeline_layout) {
         log_info(&app->log, "destroy pipeline layout");
@@ -961,6 +2295,61 @@ void app_free(App *app) { /*{{{*/
         log_info(&app->log, "destroy surface");
         vkDestroySurfaceKHR(app->instance, app->surface, 0);
     }
+    if(app->particles.device) {
+        log_info(&app->log, "destroy particles, %zu steps", (size_t)app->particles.steps);
+        particles_free(&app->particles);
+    }
+    if(app->culling.device) {
+        log_info(&app->log, "destroy gpu culling");
+        culling_free(&app->culling);
+    }
+    if(app->bindless.device) {
+        log_info(&app->log, "destroy bindless descriptors, %u textures and %u buffers in use",
+                bindless_used(&app->bindless, BINDLESS_TEXTURE), bindless_used(&app->bindless, BINDLESS_BUFFER));
+        bindless_free(&app->bindless);
+    }
+    array_free(app->materials.slots);
+    if(app->frame_uniforms.device) {
+        log_info(&app->log, "destroy frame uniforms");
+        frame_uniforms_free(&app->frame_uniforms);
+    }
+    if(app->textures.device) {
+        log_info(&app->log, "destroy %zu textures%s", array_len(app->textures.textures),
+                textures_streaming(&app->textures) ? ", some still streaming" : "");
+        textures_free(&app->textures);
+    }
+    array_free(app->texture_paths);
+    if(app->bindless_defaults.sampler) {
+        vkDestroySampler(app->device, app->bindless_defaults.sampler, 0);
+    }
+    if(app->bindless_defaults.view) {
+        vkDestroyImageView(app->device, app->bindless_defaults.view, 0);
+    }
+    if(app->gpu_memory.device) {
+        log_info(&app->log, "destroy bindless defaults and materials");
+        if(app->bindless_defaults.image) {
+            gpu_memory_destroy_image(&app->gpu_memory, app->bindless_defaults.image, &app->bindless_defaults.allocation);
+        }
+        if(app->bindless_defaults.buffer) {
+            gpu_memory_destroy_buffer(&app->gpu_memory, app->bindless_defaults.buffer, &app->bindless_defaults.buffer_allocation);
+        }
+        if(app->materials.buffer) {
+            gpu_memory_destroy_buffer(&app->gpu_memory, app->materials.buffer, &app->materials.allocation);
+        }
+    }
+    if(app->gpu_memory.device) {
+        log_info(&app->log, "destroy geometry");
+        geometry_destroy(&app->geometry, &app->gpu_memory);
+    }
+    if(app->upload.device) {
+        log_info(&app->log, "destroy upload queue, %zu bytes uploaded", (size_t)app->upload.bytes);
+        upload_free(&app->upload);
+    }
+    if(app->gpu_memory.device) {
+        app_log_gpu_memory(app);
+        log_info(&app->log, "free gpu memory");
+        gpu_memory_free_all(&app->gpu_memory);
+    }
     if(app->device) {
         log_info(&app->log, "destroy logical device");
         vkDestroyDevice(app->device, 0);
@@ -973,84 +2362,288 @@ void app_free(App *app) { /*{{{*/
         log_info(&app->log, "destroy instance");
         vkDestroyInstance(app->instance, 0);
     }
-    glfwDestroyWindow(app->window);
-    glfwTerminate();
+    if(app->display == APP_DISPLAY_WINDOW) {
+        glfwDestroyWindow(app->window);
+        glfwTerminate();
+    }
     array_free(app->physical.available);
+    startup_free(&app->startup);
+    shader_registry_free(&app->shaders);
+    array_free(app->physical.profiles);
+    device_cache_free(&app->physical.cache);
     array_free(app->swap_chain_images);
     array_free(app->swap_chain_image_views);
     array_free(app->command_buffer);
     array_free(app->render_finished_semaphore);
     array_free(app->image_available_semaphore);
-    array_free(app->in_flight_scene);
+    array_free(app->timestamps.pool);
+    array_free(app->timestamps.frame);
+    array_free(app->timestamps.pending);
+    array_free(app->statistics.pool);
+    array_free(app->statistics.pending);
     array_free(app->required_extensions);
     array_free(app->validation.layers);
     array_free(app->device_extensions);
+    frame_stats_free(&app->stats);
     log_ok(&app->log, "cleaned up");
     log_up(&app->log);
 } /*}}}*/
 
+void app_mark_frame(App *app, FrameStat stat) {
+    assert_arg(app);
+    double begin = app->stats.t_mark;
+    frame_stats_mark(&app->stats, stat);
+    log_span_add(&app->log, frame_stats_name(stat), begin, app->stats.t_mark);
+}
+
+void app_end_frame(App *app) {
+    assert_arg(app);
+    if(app->log.trace) {
+        char name[LOG_SPAN_NAME];
+        snprintf(name, sizeof(name), "frame %zu", app->stats.frames - 1);
+        log_span_add(&app->log, name, app->stats.t_begin, frame_stats_now());
+    }
+    frame_stats_end(&app->stats);
+}
+
+/* the requested variant once it compiled, the default pipeline until then */
+VkPipeline app_pipeline(App *app) {
+    assert_arg(app);
+    VkPipeline pipeline = pipeline_variants_get(&app->variants, &app->variant, app->graphics_pipeline);
+    if(pipeline != app->pipeline_bound) {
+        log_info(&app->log, "switch to pipeline variant %016llx", (unsigned long long)pipeline_state_hash(&app->variant));
+        app->pipeline_bound = pipeline;
+        app->cached_commands.dirty = true;
+    }
+    return pipeline;
+}
+
+/* frame N signals N + 1 on the timeline once the gpu is done with it */
+uint64_t app_frames_completed(App *app) {
+    assert_arg(app);
+    uint64_t value = 0;
+    if(app->timeline.value(app->device, app->timeline.semaphore, &value) != VK_SUCCESS) return 0;
+    return value;
+}
+
+int app_wait_frames_completed(App *app, uint64_t frames) {
+    assert_arg(app);
+    if(!frames) return 0;
+    VkSemaphoreWaitInfoKHR wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+        .semaphoreCount = 1,
+        .pSemaphores = &app->timeline.semaphore,
+        .pValues = &frames,
+    };
+    try(app->timeline.wait(app->device, &wait_info, UINT64_MAX));
+    return 0;
+error:
+    return -1;
+}
+
 int app_render(App *app) {
     assert_arg(app);
-    VkFence *in_flight_scene = array_it(app->in_flight_scene, app->current_frame);
-    vkWaitForFences(app->device, 1, in_flight_scene, VK_TRUE, UINT64_MAX);
+    pacing_limit(&app->pacing);
+    frame_stats_begin(&app->stats);
+    /* the previous user of this frame's slot */
+    if(app->frame_count >= app->frames_in_flight) {
+        try(app_wait_frames_completed(app, app->frame_count + 1 - app->frames_in_flight));
+    }
+    /* in latency mode this also waits for the previous frame to be on screen */
+    pacing_present_poll(&app->pacing, app->device, app->swap_chain, &app->stats);
+    app_mark_frame(app, FRAME_STAT_FENCE);
+    deletion_queue_flush(&app->deletion_queue, app->device, app_frames_completed(app));
+    bindless_flush(&app->bindless, app_frames_completed(app));
+    upload_poll(&app->upload);
+    if(textures_streaming(&app->textures)) {
+        /* sharper levels replace the slots the command buffers were recorded with */
+        bool changed = false;
+        try(textures_update(&app->textures, app->frame_count, &changed));
+        if(changed) app->cached_commands.dirty = true;
+        try(textures_stream(&app->textures, TEXTURES_STREAM_BUDGET));
+    }
+    if(!app->cached_commands.enable) {
+        app_read_compute_timestamps(app, app->current_frame);
+        app_read_timestamps(app, app->current_frame);
+        app_read_statistics(app, app->current_frame);
+    }
 
     VkSemaphore *image_available_semaphore = array_it(app->image_available_semaphore, app->current_frame);
-    VkSemaphore *render_finished_semaphore = array_it(app->image_available_semaphore, app->current_frame);
+    VkSemaphore *render_finished_semaphore = array_it(app->render_finished_semaphore, app->current_frame);
     VkCommandBuffer *command_buffer = array_it(app->command_buffer, app->current_frame);
 
-    uint32_t image_index;
-    VkResult result = vkAcquireNextImageKHR(app->device, app->swap_chain, UINT64_MAX, *image_available_semaphore, VK_NULL_HANDLE, &image_index);
+    uint32_t image_index = app->current_frame;
+    VkResult result = VK_SUCCESS;
+    bool present = (app->display != APP_DISPLAY_OFFSCREEN);
+    if(present) {
+        result = vkAcquireNextImageKHR(app->device, app->swap_chain, UINT64_MAX, *image_available_semaphore, VK_NULL_HANDLE, &image_index);
+        app_mark_frame(app, FRAME_STAT_ACQUIRE);
+    }
     if(result == VK_ERROR_OUT_OF_DATE_KHR) {
         try(app_init_vulkan_recreate_swap_chain(app));
+        /* nothing was drawn, only the recreation is worth keeping */
+        frame_stats_skip(&app->stats);
+        app_end_frame(app);
         return 0;
     } else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         THROW("failed to acquire swap chain image!");
     }
-    vkResetFences(app->device, 1, in_flight_scene);
-    vkResetCommandBuffer(*command_buffer, 0);
-    try(record_command_buffer(*command_buffer, app->render_pass, app->swap_chain_extent, app->graphics_pipeline, app->swap_chain_framebuffers, image_index));
-    VkSemaphore wait_semaphores[] = {
-        *image_available_semaphore,
-    };
+    VkPipeline pipeline = app_pipeline(app);
+    size_t query_slot = app->current_frame;
+    VkQueryPool statistics_pool = VK_NULL_HANDLE;
+    if(app->cached_commands.enable) {
+        if(app->cached_commands.dirty) {
+            try(app_record_cached_commands(app));
+        }
+        /* the cached command buffer of this image may still be executing */
+        uint64_t *image_in_flight = array_it(app->cached_commands.images_in_flight, image_index);
+        try(app_wait_frames_completed(app, *image_in_flight));
+        *image_in_flight = app->frame_count + 1;
+        query_slot = image_index;
+        app_read_timestamps(app, query_slot);
+        command_buffer = array_it(app->cached_commands.buffers, image_index);
+    } else {
+        vkResetCommandBuffer(*command_buffer, 0);
+        /* the frame that last used this region completed above */
+        FrameData data;
+        app_frame_data(app, &data);
+        frame_uniforms_begin(&app->frame_uniforms, app->current_frame);
+        try(frame_uniforms_push(&app->frame_uniforms, app->current_frame, &data, sizeof(data), &app->frame_data.offset));
+        AppTarget target = app_target(app, image_index);
+        if(app->recorder.threads) {
+            RecorderJob job = {
+                .render_pass = target.render_pass,
+                .framebuffer = target.framebuffer,
+                .color_format = app->swap_chain_image_format,
+                .depth_format = app->depth.format,
+                .samples = app->msaa.samples,
+                .extent = target.extent,
+                .pipeline = pipeline,
+                .layout = app->pipeline_layout,
+                .descriptor_sets = { app->bindless.set, app->frame_uniforms.set },
+                .frame_offset = app->frame_data.offset,
+                .geometry = &app->geometry,
+                .texture = textures_slot(&app->textures, 0),
+                .materials = app->materials.slots,
+                .material_count = app->materials.count,
+                .particles = app->particles.count ? particles_buffer(&app->particles, app->frame_count) : VK_NULL_HANDLE,
+                .particle_count = app->particles.count,
+                .frame = app->current_frame,
+            };
+            try(recorder_record(&app->recorder, &job));
+        }
+        statistics_pool = array_len(app->recorder.recorded) ? VK_NULL_HANDLE : app_statistics_pool(app, app->current_frame);
+        try(record_command_buffer(app, *command_buffer, &target, pipeline, app->recorder.recorded, app_query_pool(app, query_slot), statistics_pool));
+    }
+    VkQueryPool query_pool = app_query_pool(app, query_slot);
+    app_mark_frame(app, FRAME_STAT_RECORD);
+    if(app->particles.count) {
+        try(particles_step(&app->particles, app->stats.frames - 1, app->timeline.semaphore));
+    }
+    /* the acquired image, and the particles this frame draws */
+    VkSemaphore wait_semaphores[2];
+    VkPipelineStageFlags wait_stages[2];
+    uint64_t wait_values[2];
+    uint32_t wait_count = 0;
+    if(present) {
+        wait_semaphores[wait_count] = *image_available_semaphore;
+        wait_stages[wait_count] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        wait_values[wait_count++] = 0;
+    }
+    if(app->particles.count) {
+        wait_semaphores[wait_count] = app->particles.timeline;
+        wait_stages[wait_count] = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        wait_values[wait_count++] = app->particles.steps;
+    }
+    /* the timeline first, render finished is only for the present */
     VkSemaphore signal_semaphores[] = {
+        app->timeline.semaphore,
         *render_finished_semaphore,
     };
-    VkPipelineStageFlags wait_stages[] = {
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+    uint64_t signal_values[] = {
+        app->frame_count + 1,
+        0,
+    };
+    VkTimelineSemaphoreSubmitInfoKHR timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .waitSemaphoreValueCount = wait_count,
+        .pWaitSemaphoreValues = wait_values,
+        .signalSemaphoreValueCount = present ? 2 : 1,
+        .pSignalSemaphoreValues = signal_values,
     };
     VkSubmitInfo submit_info = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .waitSemaphoreCount = 1,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = wait_count,
         .pWaitSemaphores = wait_semaphores,
         .pWaitDstStageMask = wait_stages,
         .commandBufferCount = 1,
         .pCommandBuffers = command_buffer,
-        .signalSemaphoreCount = 1,
+        .signalSemaphoreCount = present ? 2 : 1,
         .pSignalSemaphores = signal_semaphores,
     };
-    try(vkQueueSubmit(app->graphics_queue, 1, &submit_info, *in_flight_scene));
+    /* pending acquire barriers go to the graphics queue ahead of this frame */
+    try(upload_flush(&app->upload));
+    try(vkQueueSubmit(app->graphics_queue, 1, &submit_info, VK_NULL_HANDLE));
+    if(query_pool) {
+        *array_it(app->timestamps.pending, query_slot) = true;
+        *array_it(app->timestamps.frame, query_slot) = app->stats.frames - 1;
+    }
+    if(statistics_pool) {
+        *array_it(app->statistics.pending, app->current_frame) = true;
+    }
+    app_mark_frame(app, FRAME_STAT_SUBMIT);
+    if(!present) {
+        /* nothing reports out of date offscreen, only forced recreation (--bench-resize) */
+        if(app->swap_chain_recreate) {
+            try(app_init_vulkan_recreate_swap_chain(app));
+        }
+        goto done;
+    }
     VkSwapchainKHR swapchains[] = {
         app->swap_chain,
     };
+    uint64_t present_id = pacing_present_id(&app->pacing, app->stats.frames - 1);
+    VkPresentIdKHR present_ids = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .swapchainCount = 1,
+        .pPresentIds = &present_id,
+    };
     VkPresentInfoKHR present_info = {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .pNext = present_id ? &present_ids : 0,
         .waitSemaphoreCount = 1,
-        .pWaitSemaphores = signal_semaphores,
+        .pWaitSemaphores = render_finished_semaphore,
         .swapchainCount = 1,
         .pSwapchains = swapchains,
         .pImageIndices = &image_index,
         .pResults = 0, // optional
     };
     result = vkQueuePresentKHR(app->present_queue, &present_info);
-    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || app->framebuffer_resized) {
-        app->framebuffer_resized = false;
+    app_mark_frame(app, FRAME_STAT_PRESENT);
+    if(app_swap_chain_needs_recreate(app, result)) {
         try(app_init_vulkan_recreate_swap_chain(app));
-    } else if(result != VK_SUCCESS) {
+    } else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         THROW("failed to present swap chain image");
     }
-    app->current_frame = (app->current_frame + 1) % APP_MAX_FRAMES_IN_FLIGHT;
+done:
+    app->current_frame = (app->current_frame + 1) % app->frames_in_flight;
+    ++app->frame_count;
+    app_end_frame(app);
     return 0;
 error:
     return -1;
 }
 
+bool app_should_close(App *app) {
+    assert_arg(app);
+    if(!app->window) return false;
+    return glfwWindowShouldClose(app->window);
+}
+
+void app_poll_events(App *app) {
+    assert_arg(app);
+    if(!app->window) return;
+    glfwPollEvents();
+}
+
@@ -2,7 +2,13 @@
 
 #define APP_WIDTH   800
 #define APP_HEIGHT  600
-#define APP_MAX_FRAMES_IN_FLIGHT    2
+#define APP_FRAMES_IN_FLIGHT        2
+#define APP_MAX_FRAMES_IN_FLIGHT    4
+#define APP_OFFSCREEN_FORMAT        VK_FORMAT_B8G8R8A8_SRGB
+#define APP_PIPELINE_CACHE_PATH     "pipeline_cache.bin"
+#define APP_DEVICE_CACHE_PATH       "device_cache.txt"
+#define APP_DEVICE_ENV              "C_VULKAN_DEVICE"   // device index or name substring
+#define APP_RESIZE_SETTLE_SEC       0.05
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -23,12 +29,40 @@ VEC_INCLUDE(VCs, vcs, const char *, BY_VAL, ERR);
 
 #include "swap_chain_support.h"
 #include "queue_family.h"
+#include "device_profile.h"
 #include "log.h"
+#include "frame_stats.h"
+#include "pipeline_cache.h"
+#include "pipeline_variants.h"
+#include "deletion_queue.h"
+#include "gpu_memory.h"
+#include "upload.h"
+#include "geometry.h"
+#include "recorder.h"
+#include "startup.h"
+#include "pacing.h"
+#include "shader_registry.h"
+#include "particles.h"
+#include "attachment.h"
+#include "culling.h"
+#include "bindless.h"
+#include "frame_uniforms.h"
+#include "texture.h"
+
+typedef enum {
+    APP_DISPLAY_WINDOW,             // glfw window + surface + swap chain
+    APP_DISPLAY_OFFSCREEN,          // no surface, render into a ring of VkImage
+    APP_DISPLAY_HEADLESS_SURFACE,   // VK_EXT_headless_surface + swap chain, no window
+} AppDisplay;
 
 typedef struct App {
     const char *name;   // window name
     const char *engine; // engine name
     Log log;
+    FrameStats stats;
+    AppDisplay display;
+    bool serial_startup;        // run the init steps one after another
+    Startup startup;
     GLFWwindow *window;
     char const **required_extensions;
     char const **device_extensions;
@@ -42,32 +76,146 @@ typedef struct App {
         QueueFamilyIndices indices;
         VkPhysicalDevice active;
         VkPhysicalDevice *available;
+        DeviceCache cache;
+        size_t *profiles;       // cache.profiles index per available device
+        size_t profile;         // cache.profiles index of active
+        const char *override;   // index or name substring, APP_DEVICE_ENV otherwise
     } physical;
+    struct {
+        bool creation_feedback;     // VK_EXT_pipeline_creation_feedback
+        bool present_wait;          // VK_KHR_present_id + VK_KHR_present_wait
+        bool dynamic_rendering;     // VK_KHR_dynamic_rendering + VK_KHR_synchronization2
+        bool pipeline_statistics;   // pipelineStatisticsQuery, only enabled for the overdraw scene
+        bool draw_indirect_count;   // VK_KHR_draw_indirect_count, only enabled for gpu culling
+        bool descriptor_indexing;   // VK_EXT_descriptor_indexing, update after bind for the bindless set
+    } features;
+    bool force_render_pass;         // --render-pass, keep VkRenderPass and VkFramebuffer
     VkDevice device;
+    GpuMemory gpu_memory;
     VkQueue graphics_queue;
     VkSurfaceKHR surface;
     VkQueue present_queue;
+    VkQueue transfer_queue;
+    VkQueue compute_queue;
+    Upload upload;
+    Geometry geometry;
+    Particles particles;
+    Culling culling;
+    Bindless bindless;
+    struct {
+        VkImage image;              // 1x1 white
+        VkImageView view;
+        GpuAllocation allocation;
+        VkSampler sampler;
+        VkBuffer buffer;            // white tint
+        GpuAllocation buffer_allocation;
+    } bindless_defaults;
+    struct {
+        uint32_t count;             // --materials, 0 draws everything with the defaults
+        VkBuffer buffer;            // the tints of every material, a bindless slot each
+        GpuAllocation allocation;
+        uint32_t *slots;
+    } materials;
+    FrameUniforms frame_uniforms;
+    Textures textures;
+    const char **texture_paths;     // --texture, the first one is drawn
+    struct {
+        float x, y;                 // center of the view
+        float zoom;                 // --zoom, 0 is 1
+    } camera;
+    struct {
+        double start;               // time of the first frame
+        double last;
+        uint32_t offset;            // dynamic offset of the FrameData the next recording binds
+    } frame_data;
+    Pacing pacing;
     VkSwapchainKHR swap_chain;
     VkImage *swap_chain_images;
     VkFormat swap_chain_image_format;
     VkExtent2D swap_chain_extent;
     VkImageView *swap_chain_image_views;
-    VkRenderPass render_pass;
+    struct {
+        uint32_t requested;         // --msaa, 0 and 1 are off
+        VkSampleCountFlagBits samples;
+        Attachment color;           // resolved into the swap chain image at the end of the pass
+    } msaa;
+    struct {
+        VkFormat format;
+        Attachment attachment;      // cleared every pass, never stored
+    } depth;
+    struct {
+        GpuAllocation *allocations; // backs swap_chain_images in APP_DISPLAY_OFFSCREEN
+    } offscreen;
+    VkRenderPass render_pass;       // VK_NULL_HANDLE with dynamic rendering
+    struct {
+        PFN_vkCmdBeginRenderingKHR begin;
+        PFN_vkCmdEndRenderingKHR end;
+        PFN_vkCmdPipelineBarrier2KHR barrier;
+    } rendering;
+    PipelineCache pipeline_cache;
+    ShaderRegistry shaders;
+    struct {
+        VkShaderModule vert;
+        VkShaderModule frag;
+    } shader_modules;           // kept for variants compiled later
     VkPipelineLayout pipeline_layout;
-    VkPipeline graphics_pipeline;
-    VkFramebuffer *swap_chain_framebuffers;
+    PipelineVariants variants;
+    VkPipeline graphics_pipeline;   // default variant, drawn while others compile
+    const char *variant_name;       // --variant
+    PipelineState variant;
+    VkPipeline pipeline_bound;      // what the command buffers were last recorded with
+    VkFramebuffer *swap_chain_framebuffers;    // empty with dynamic rendering
     VkCommandPool command_pool;
     VkCommandBuffer *command_buffer;
+    Recorder recorder;
+    struct {
+        bool enable;                // record once per framebuffer instead of every frame
+        bool dirty;                 // re-record before the next frame
+        VkCommandBuffer *buffers;   // one per swap chain image
+        uint64_t *images_in_flight; // timeline value of the frame that last submitted the buffer (or the one it replaced)
+        bool frame_written;         // FrameData in the static region, replayed every frame
+    } cached_commands;
     VkSemaphore *image_available_semaphore;
     VkSemaphore *render_finished_semaphore;
-    VkFence *in_flight_scene;
+    struct {
+        VkSemaphore semaphore;      // frame N signals N + 1 once completed
+        PFN_vkWaitSemaphoresKHR wait;
+        PFN_vkGetSemaphoreCounterValueKHR value;
+    } timeline;
+    struct {
+        VkQueryPool *pool;      // per frame in flight (per image if cached), begin/end of the render pass
+        size_t *frame;          // frame stats index the pool was last written for
+        bool *pending;          // results not yet read back
+        double period;          // nanoseconds per tick
+        uint64_t mask;          // valid bits of the graphics queue family
+        uint64_t compute_mask;  // valid bits of the compute queue family, for the particle step
+        uint64_t last[2];       // ticks of the last frame read, for the particle step overlapping it
+        size_t last_frame;
+        bool last_valid;
+    } timestamps;
+    struct {
+        VkQueryPool *pool;      // fragment shader invocations, one per frame in flight
+        bool *pending;
+        double fragments;       // summed over the frames read
+        size_t frames;
+    } statistics;
+    DeletionQueue deletion_queue;
+    size_t frames_in_flight;    // 1 to APP_MAX_FRAMES_IN_FLIGHT, 0 is APP_FRAMES_IN_FLIGHT
     uint32_t current_frame;
+    size_t frame_count;         // submitted frames
     bool framebuffer_resized;
+    double framebuffer_resized_at;
+    bool swap_chain_recreate;   // force recreation after the next present
 } App;
 
 int app_init(App *app);
 void app_free(App *app);
 int app_render(App *app);
+bool app_should_close(App *app);
+void app_poll_events(App *app);
+uint64_t app_frames_completed(App *app);
+double app_fragments_per_pixel(App *app);
+int app_wait_frames_completed(App *app, uint64_t frames);
 
 #define APP_H
 #endif
@@ -0,0 +1,87 @@
+#include <string.h>
+#include "attachment.h"
+
+/* the largest supported count not above the requested one, 1 always works */
+VkSampleCountFlagBits attachment_samples(VkSampleCountFlags supported, uint32_t requested) {
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    for(uint32_t count = 2; count <= VK_SAMPLE_COUNT_64_BIT && count <= requested; count <<= 1) {
+        if(supported & count) samples = (VkSampleCountFlagBits)count;
+    }
+    return samples;
+}
+
+/* the first candidate usable as an optimal tiling depth attachment, VK_FORMAT_UNDEFINED if none */
+VkFormat attachment_depth_format(VkPhysicalDevice physical) {
+    static const VkFormat candidates[] = {
+        VK_FORMAT_D32_SFLOAT,
+        VK_FORMAT_D32_SFLOAT_S8_UINT,
+        VK_FORMAT_D24_UNORM_S8_UINT,
+        VK_FORMAT_X8_D24_UNORM_PACK32,
+        VK_FORMAT_D16_UNORM,
+    };
+    for(size_t i = 0; i < sizearray(candidates); ++i) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physical, candidates[i], &properties);
+        if(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return candidates[i];
+        }
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool attachment_has_stencil(VkFormat format) {
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+        format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_S8_UINT;
+}
+
+int attachment_create(Attachment *attachment, GpuMemory *gpu_memory, VkFormat format, VkExtent2D extent, VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImageAspectFlags aspect) {
+    assert_arg(attachment);
+    assert_arg(gpu_memory);
+    memset(attachment, 0, sizeof(*attachment));
+    attachment->format = format;
+    attachment->samples = samples;
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = { extent.width, extent.height, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = samples,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    try(gpu_memory_create_image(gpu_memory, &image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &attachment->image, &attachment->allocation));
+    VkMemoryPropertyFlags flags = gpu_memory->properties.memoryTypes[attachment->allocation.memory_type].propertyFlags;
+    attachment->lazy = (flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = attachment->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange = {
+            .aspectMask = aspect,
+            .levelCount = 1,
+            .layerCount = 1,
+        },
+    };
+    try(vkCreateImageView(gpu_memory->device, &view_info, 0, &attachment->view));
+    return 0;
+error:
+    attachment_destroy(attachment, gpu_memory);
+    return -1;
+}
+
+void attachment_destroy(Attachment *attachment, GpuMemory *gpu_memory) {
+    assert_arg(attachment);
+    assert_arg(gpu_memory);
+    vkDestroyImageView(gpu_memory->device, attachment->view, 0);
+    if(attachment->image) {
+        gpu_memory_destroy_image(gpu_memory, attachment->image, &attachment->allocation);
+    }
+    memset(attachment, 0, sizeof(*attachment));
+}
+
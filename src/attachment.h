@@ -0,0 +1,30 @@
+#ifndef ATTACHMENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "gpu_memory.h"
+#include "util.h"
+
+/* render target that only lives inside a render pass (msaa color, depth).
+ * transient usage with lazily allocated memory where the device has it: on
+ * tile based gpus it then stays in tile memory and never gets backing store.
+ * always a dedicated allocation, never suballocated from a block */
+typedef struct Attachment {
+    VkImage image;
+    VkImageView view;
+    GpuAllocation allocation;
+    VkFormat format;
+    VkSampleCountFlagBits samples;
+    bool lazy;                  // backed by lazily allocated memory
+} Attachment;
+
+VkSampleCountFlagBits attachment_samples(VkSampleCountFlags supported, uint32_t requested);
+VkFormat attachment_depth_format(VkPhysicalDevice physical);
+bool attachment_has_stencil(VkFormat format);
+int attachment_create(Attachment *attachment, GpuMemory *gpu_memory, VkFormat format, VkExtent2D extent, VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImageAspectFlags aspect);
+void attachment_destroy(Attachment *attachment, GpuMemory *gpu_memory);
+
+#define ATTACHMENT_H
+#endif
+
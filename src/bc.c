@@ -0,0 +1,178 @@
+#include <string.h>
+#include "bc.h"
+
+/* bytes per block, 0 if not block compressed */
+uint32_t bc_block_size(VkFormat format) {
+    switch(format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            return 8;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+VkDeviceSize bc_level_size(VkFormat format, VkExtent3D extent) {
+    VkDeviceSize blocks_x = (extent.width + BC_BLOCK - 1) / BC_BLOCK;
+    VkDeviceSize blocks_y = (extent.height + BC_BLOCK - 1) / BC_BLOCK;
+    return blocks_x * blocks_y * bc_block_size(format);
+}
+
+/* what bc_decode writes, VK_FORMAT_UNDEFINED if it can't decode the format (BC7) */
+VkFormat bc_decoded_format(VkFormat format) {
+    switch(format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        default:
+            return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static uint16_t bc_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static void bc_565(uint16_t c, uint8_t rgb[3]) {
+    uint8_t r = (c >> 11) & 0x1f;
+    uint8_t g = (c >> 5) & 0x3f;
+    uint8_t b = c & 0x1f;
+    rgb[0] = (uint8_t)(r << 3 | r >> 2);
+    rgb[1] = (uint8_t)(g << 2 | g >> 4);
+    rgb[2] = (uint8_t)(b << 3 | b >> 2);
+}
+
+/* 8 bytes, rgba of 16 texels. punch through alpha only for BC1 */
+static void bc_decode_color(const uint8_t *block, bool punch_through, uint8_t out[16][4]) {
+    uint16_t c0 = bc_u16(block);
+    uint16_t c1 = bc_u16(block + 2);
+    uint8_t palette[4][4];
+    bc_565(c0, palette[0]);
+    bc_565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+    for(int i = 0; i < 3; ++i) {
+        if(c0 > c1 || !punch_through) {
+            palette[2][i] = (uint8_t)((2 * palette[0][i] + palette[1][i]) / 3);
+            palette[3][i] = (uint8_t)((palette[0][i] + 2 * palette[1][i]) / 3);
+        } else {
+            palette[2][i] = (uint8_t)((palette[0][i] + palette[1][i]) / 2);
+            palette[3][i] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = (c0 > c1 || !punch_through) ? 255 : 0;
+    uint32_t indices = (uint32_t)block[4] | (uint32_t)block[5] << 8 | (uint32_t)block[6] << 16 | (uint32_t)block[7] << 24;
+    for(int t = 0; t < 16; ++t) {
+        memcpy(out[t], palette[(indices >> (2 * t)) & 3], 4);
+    }
+}
+
+/* 8 bytes of BC4, one channel of 16 texels */
+static void bc_decode_channel(const uint8_t *block, uint8_t out[16][4], int channel) {
+    uint8_t a0 = block[0];
+    uint8_t a1 = block[1];
+    uint8_t palette[8] = { a0, a1 };
+    if(a0 > a1) {
+        for(int i = 1; i < 7; ++i) {
+            palette[i + 1] = (uint8_t)(((7 - i) * a0 + i * a1) / 7);
+        }
+    } else {
+        for(int i = 1; i < 5; ++i) {
+            palette[i + 1] = (uint8_t)(((5 - i) * a0 + i * a1) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for(int i = 0; i < 6; ++i) {
+        indices |= (uint64_t)block[2 + i] << (8 * i);
+    }
+    for(int t = 0; t < 16; ++t) {
+        out[t][channel] = palette[(indices >> (3 * t)) & 7];
+    }
+}
+
+/* 8 bytes of BC2, explicit 4 bit alpha */
+static void bc_decode_alpha4(const uint8_t *block, uint8_t out[16][4]) {
+    for(int t = 0; t < 16; ++t) {
+        uint8_t a = (block[t / 2] >> (4 * (t % 2))) & 0xf;
+        out[t][3] = (uint8_t)(a << 4 | a);
+    }
+}
+
+static void bc_decode_block(VkFormat format, const uint8_t *block, uint8_t out[16][4]) {
+    switch(format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            bc_decode_color(block, true, out);
+            for(int t = 0; t < 16; ++t) out[t][3] = 255;
+            break;
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            bc_decode_color(block, true, out);
+            break;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+            bc_decode_color(block + 8, false, out);
+            bc_decode_alpha4(block, out);
+            break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            bc_decode_color(block + 8, false, out);
+            bc_decode_channel(block, out, 3);
+            break;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            memset(out, 0, 16 * 4);
+            bc_decode_channel(block, out, 0);
+            for(int t = 0; t < 16; ++t) out[t][3] = 255;
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            memset(out, 0, 16 * 4);
+            bc_decode_channel(block, out, 0);
+            bc_decode_channel(block + 8, out, 1);
+            for(int t = 0; t < 16; ++t) out[t][3] = 255;
+            break;
+        default:
+            break;
+    }
+}
+
+/* rgba holds width * height texels, blocks past the edge are clipped */
+void bc_decode(VkFormat format, const void *blocks, VkExtent3D extent, uint8_t *rgba) {
+    assert_arg(blocks);
+    assert_arg(rgba);
+    const uint8_t *block = blocks;
+    uint32_t block_size = bc_block_size(format);
+    for(uint32_t by = 0; by < extent.height; by += BC_BLOCK) {
+        for(uint32_t bx = 0; bx < extent.width; bx += BC_BLOCK) {
+            uint8_t texels[16][4];
+            bc_decode_block(format, block, texels);
+            block += block_size;
+            for(uint32_t y = 0; y < BC_BLOCK && by + y < extent.height; ++y) {
+                for(uint32_t x = 0; x < BC_BLOCK && bx + x < extent.width; ++x) {
+                    memcpy(rgba + ((size_t)(by + y) * extent.width + bx + x) * 4, texels[y * BC_BLOCK + x], 4);
+                }
+            }
+        }
+    }
+}
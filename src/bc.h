@@ -0,0 +1,21 @@
+#ifndef BC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "util.h"
+
+#define BC_BLOCK    4           // texels per block edge
+
+/* block compressed formats: sizes, and a cpu decoder for devices without
+ * textureCompressionBC. decoded levels are R8G8B8A8, read as the format
+ * would be sampled (BC4 is r001, BC5 rg01) */
+uint32_t bc_block_size(VkFormat format);
+VkDeviceSize bc_level_size(VkFormat format, VkExtent3D extent);
+VkFormat bc_decoded_format(VkFormat format);
+void bc_decode(VkFormat format, const void *blocks, VkExtent3D extent, uint8_t *rgba);
+
+#define BC_H
+#endif
+
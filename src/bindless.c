@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <string.h>
+#include <rlc/array.h>
+#include "bindless.h"
+
+int bindless_init(Bindless *bindless, VkDevice device, uint32_t textures, uint32_t buffers, bool update_after_bind) {
+    assert_arg(bindless);
+    bindless->device = device;
+    bindless->update_after_bind = update_after_bind;
+    bindless->slots[BINDLESS_TEXTURE].capacity = textures;
+    bindless->slots[BINDLESS_BUFFER].capacity = buffers;
+    VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            .binding = BINDLESS_TEXTURE,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = textures,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        },
+        {
+            .binding = BINDLESS_BUFFER,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = buffers,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        },
+    };
+    /* every slot always holds a valid descriptor, so partially bound is not needed */
+    VkDescriptorBindingFlagsEXT binding_flags[] = {
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT,
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT,
+    };
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flags_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT,
+        .bindingCount = sizearray(binding_flags),
+        .pBindingFlags = binding_flags,
+    };
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = sizearray(bindings),
+        .pBindings = bindings,
+    };
+    VkDescriptorPoolSize pool_sizes[] = {
+        { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = textures },
+        { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = buffers },
+    };
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = 1,
+        .poolSizeCount = sizearray(pool_sizes),
+        .pPoolSizes = pool_sizes,
+    };
+    if(update_after_bind) {
+        layout_info.pNext = &flags_info;
+        layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+        pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    }
+    try(vkCreateDescriptorSetLayout(device, &layout_info, 0, &bindless->set_layout));
+    try(vkCreateDescriptorPool(device, &pool_info, 0, &bindless->pool));
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = bindless->pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &bindless->set_layout,
+    };
+    try(vkAllocateDescriptorSets(device, &alloc_info, &bindless->set));
+    return 0;
+error:
+    return -1;
+}
+
+void bindless_free(Bindless *bindless) {
+    assert_arg(bindless);
+    vkDestroyDescriptorPool(bindless->device, bindless->pool, 0);
+    vkDestroyDescriptorSetLayout(bindless->device, bindless->set_layout, 0);
+    for(size_t i = 0; i < BINDLESS__COUNT; ++i) {
+        array_free(bindless->slots[i].free);
+    }
+    array_free(bindless->retired);
+    memset(bindless, 0, sizeof(*bindless));
+}
+
+static bool bindless_writable(Bindless *bindless) {
+    assert_arg(bindless);
+    if(bindless->update_after_bind || !bindless->bound) return true;
+    println("bindless slots can't change once bound without descriptor indexing");
+    return false;
+}
+
+static void bindless_write(Bindless *bindless, BindlessKind kind, uint32_t first, uint32_t count, const VkDescriptorImageInfo *images, const VkDescriptorBufferInfo *buffers) {
+    assert_arg(bindless);
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = bindless->set,
+        .dstBinding = kind,
+        .dstArrayElement = first,
+        .descriptorCount = count,
+        .descriptorType = kind == BINDLESS_TEXTURE ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pImageInfo = images,
+        .pBufferInfo = buffers,
+    };
+    vkUpdateDescriptorSets(bindless->device, 1, &write, 0, 0);
+}
+
+/* the defaults take BINDLESS_DEFAULT and fill every other slot, so any index in range is valid */
+int bindless_set_defaults(Bindless *bindless, VkImageView view, VkSampler sampler, VkBuffer buffer) {
+    assert_arg(bindless);
+    int err = 0;
+    VkDescriptorImageInfo *images = 0;
+    VkDescriptorBufferInfo *buffers = 0;
+    bindless->default_texture = (VkDescriptorImageInfo){
+        .sampler = sampler,
+        .imageView = view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+    bindless->default_buffer = (VkDescriptorBufferInfo){
+        .buffer = buffer,
+        .range = VK_WHOLE_SIZE,
+    };
+    uint32_t textures = bindless->slots[BINDLESS_TEXTURE].capacity;
+    uint32_t buffer_count = bindless->slots[BINDLESS_BUFFER].capacity;
+    images = malloc(sizeof(*images) * textures);
+    buffers = malloc(sizeof(*buffers) * buffer_count);
+    if(!images || !buffers) goto error;
+    for(uint32_t i = 0; i < textures; ++i) images[i] = bindless->default_texture;
+    for(uint32_t i = 0; i < buffer_count; ++i) buffers[i] = bindless->default_buffer;
+    bindless_write(bindless, BINDLESS_TEXTURE, 0, textures, images, 0);
+    bindless_write(bindless, BINDLESS_BUFFER, 0, buffer_count, 0, buffers);
+    for(size_t i = 0; i < BINDLESS__COUNT; ++i) {
+        bindless->slots[i].next = BINDLESS_DEFAULT + 1;
+    }
+clean:
+    free(images);
+    free(buffers);
+    return err;
+error:
+    err = -1;
+    goto clean;
+}
+
+static uint32_t bindless_slot_alloc(Bindless *bindless, BindlessKind kind) {
+    assert_arg(bindless);
+    BindlessSlots *slots = &bindless->slots[kind];
+    if(array_len(slots->free)) {
+        uint32_t index = array_at(slots->free, array_len(slots->free) - 1);
+        array_resize(slots->free, array_len(slots->free) - 1);
+        return index;
+    }
+    if(slots->next >= slots->capacity) {
+        println("all %u bindless %s slots are in use", slots->capacity, kind == BINDLESS_TEXTURE ? "texture" : "buffer");
+        return BINDLESS_INVALID;
+    }
+    return slots->next++;
+}
+
+uint32_t bindless_add_texture(Bindless *bindless, VkImageView view, VkSampler sampler) {
+    assert_arg(bindless);
+    if(!bindless_writable(bindless)) return BINDLESS_INVALID;
+    uint32_t index = bindless_slot_alloc(bindless, BINDLESS_TEXTURE);
+    if(index == BINDLESS_INVALID) return index;
+    VkDescriptorImageInfo image = {
+        .sampler = sampler,
+        .imageView = view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+    bindless_write(bindless, BINDLESS_TEXTURE, index, 1, &image, 0);
+    return index;
+}
+
+uint32_t bindless_add_buffer(Bindless *bindless, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    assert_arg(bindless);
+    if(!bindless_writable(bindless)) return BINDLESS_INVALID;
+    uint32_t index = bindless_slot_alloc(bindless, BINDLESS_BUFFER);
+    if(index == BINDLESS_INVALID) return index;
+    VkDescriptorBufferInfo info = {
+        .buffer = buffer,
+        .offset = offset,
+        .range = range,
+    };
+    bindless_write(bindless, BINDLESS_BUFFER, index, 1, 0, &info);
+    return index;
+}
+
+/* frames up to `frame` may still read the slot, it is reused once they completed */
+void bindless_release(Bindless *bindless, BindlessKind kind, uint32_t index, uint64_t frame) {
+    assert_arg(bindless);
+    if(index == BINDLESS_INVALID || index == BINDLESS_DEFAULT) return;
+    /* fixed once bound, the slot is never rewritten or reused */
+    if(!bindless->update_after_bind && bindless->bound) return;
+    BindlessRetired retired = {
+        .kind = kind,
+        .index = index,
+        .frame = frame,
+    };
+    array_push(bindless->retired, retired);
+}
+
+/* completed is the frame timeline value: frames below it finished on the gpu */
+void bindless_flush(Bindless *bindless, uint64_t completed) {
+    assert_arg(bindless);
+    if(!array_len(bindless->retired)) return;
+    /* a set fixed once bound keeps its retired slots, quietly since this runs every frame */
+    if(!bindless->update_after_bind && bindless->bound) return;
+    size_t kept = 0;
+    for(size_t i = 0; i < array_len(bindless->retired); ++i) {
+        BindlessRetired *retired = array_it(bindless->retired, i);
+        if(retired->frame >= completed) {
+            *array_it(bindless->retired, kept++) = *retired;
+            continue;
+        }
+        /* the destroyed resource must not stay referenced by the set */
+        if(retired->kind == BINDLESS_TEXTURE) {
+            bindless_write(bindless, retired->kind, retired->index, 1, &bindless->default_texture, 0);
+        } else {
+            bindless_write(bindless, retired->kind, retired->index, 1, 0, &bindless->default_buffer);
+        }
+        array_push(bindless->slots[retired->kind].free, retired->index);
+    }
+    array_resize(bindless->retired, kept);
+}
+
+void bindless_bind(Bindless *bindless, VkCommandBuffer command_buffer, VkPipelineLayout layout) {
+    assert_arg(bindless);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &bindless->set, 0, 0);
+    bindless->bound = true;
+}
+
+uint32_t bindless_used(Bindless *bindless, BindlessKind kind) {
+    assert_arg(bindless);
+    BindlessSlots *slots = &bindless->slots[kind];
+    return slots->next - array_len(slots->free);
+}
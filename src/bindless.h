@@ -0,0 +1,69 @@
+#ifndef BINDLESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "util.h"
+
+#define BINDLESS_TEXTURES       4096
+#define BINDLESS_BUFFERS        1024
+#define BINDLESS_INVALID        UINT32_MAX
+#define BINDLESS_DEFAULT        0           // the first slot of each kind, what released slots read
+
+typedef enum {
+    BINDLESS_TEXTURE,           // binding 0, combined image samplers
+    BINDLESS_BUFFER,            // binding 1, storage buffers
+    /* add above */
+    BINDLESS__COUNT,
+} BindlessKind;
+
+/* push constants of shader.frag, the per draw indices */
+typedef struct BindlessPush {
+    uint32_t texture;           // BINDLESS_TEXTURE slot
+    uint32_t material;          // BINDLESS_BUFFER slot
+} BindlessPush;
+
+typedef struct BindlessSlots {
+    uint32_t capacity;          // descriptors in the binding
+    uint32_t next;              // slots at and above were never handed out
+    uint32_t *free;             // released slots, reused first
+} BindlessSlots;
+
+typedef struct BindlessRetired {
+    BindlessKind kind;
+    uint32_t index;
+    uint64_t frame;             // last frame that may still read the slot
+} BindlessRetired;
+
+/* one global descriptor set with an array per resource kind, bound once per
+ * command buffer. draws select their resources with indices in push constants,
+ * so adding a material never allocates or binds another set. with descriptor
+ * indexing the set is update after bind and unused slots change while frames
+ * are pending. without it slots can only change until the set is first bound */
+typedef struct Bindless {
+    VkDevice device;
+    bool update_after_bind;
+    bool bound;                 // recorded at least once
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+    BindlessSlots slots[BINDLESS__COUNT];
+    BindlessRetired *retired;
+    VkDescriptorImageInfo default_texture;
+    VkDescriptorBufferInfo default_buffer;
+} Bindless;
+
+int bindless_init(Bindless *bindless, VkDevice device, uint32_t textures, uint32_t buffers, bool update_after_bind);
+void bindless_free(Bindless *bindless);
+int bindless_set_defaults(Bindless *bindless, VkImageView view, VkSampler sampler, VkBuffer buffer);
+uint32_t bindless_add_texture(Bindless *bindless, VkImageView view, VkSampler sampler);
+uint32_t bindless_add_buffer(Bindless *bindless, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+void bindless_release(Bindless *bindless, BindlessKind kind, uint32_t index, uint64_t frame);
+void bindless_flush(Bindless *bindless, uint64_t completed);
+void bindless_bind(Bindless *bindless, VkCommandBuffer command_buffer, VkPipelineLayout layout);
+uint32_t bindless_used(Bindless *bindless, BindlessKind kind);
+
+#define BINDLESS_H
+#endif
+
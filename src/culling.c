@@ -0,0 +1,225 @@
+#include <string.h>
+#include <rlc/array.h>
+#include "culling.h"
+
+static int culling_create_buffers(Culling *culling, CullingSlot *slot) {
+    assert_arg(culling);
+    assert_arg(slot);
+    VkBufferCreateInfo draws_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = (VkDeviceSize)culling->count * sizeof(VkDrawIndexedIndirectCommand),
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    try(gpu_memory_create_buffer(culling->gpu_memory, &draws_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                &slot->draws, &slot->draws_allocation));
+    VkBufferCreateInfo count_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = sizeof(uint32_t),
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    try(gpu_memory_create_buffer(culling->gpu_memory, &count_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                &slot->count, &slot->count_allocation));
+    return 0;
+error:
+    return -1;
+}
+
+static int culling_create_descriptors(Culling *culling) {
+    assert_arg(culling);
+    size_t sets = array_len(culling->slots);
+    VkDescriptorSetLayoutBinding bindings[3];
+    for(size_t i = 0; i < sizearray(bindings); ++i) {
+        bindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = (uint32_t)i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        };
+    }
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = sizearray(bindings),
+        .pBindings = bindings,
+    };
+    try(vkCreateDescriptorSetLayout(culling->device, &layout_info, 0, &culling->set_layout));
+    VkDescriptorPoolSize pool_size = {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = sizearray(bindings) * sets,
+    };
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = sets,
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size,
+    };
+    try(vkCreateDescriptorPool(culling->device, &pool_info, 0, &culling->descriptor_pool));
+    for(size_t i = 0; i < sets; ++i) {
+        CullingSlot *slot = array_it(culling->slots, i);
+        VkDescriptorSetAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = culling->descriptor_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &culling->set_layout,
+        };
+        try(vkAllocateDescriptorSets(culling->device, &alloc_info, &slot->set));
+        VkDescriptorBufferInfo buffer_infos[] = {
+            { .buffer = culling->geometry->instance_buffer, .range = VK_WHOLE_SIZE },
+            { .buffer = slot->draws, .range = VK_WHOLE_SIZE },
+            { .buffer = slot->count, .range = VK_WHOLE_SIZE },
+        };
+        VkWriteDescriptorSet writes[sizearray(buffer_infos)];
+        for(size_t j = 0; j < sizearray(writes); ++j) {
+            writes[j] = (VkWriteDescriptorSet){
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = slot->set,
+                .dstBinding = (uint32_t)j,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &buffer_infos[j],
+            };
+        }
+        vkUpdateDescriptorSets(culling->device, sizearray(writes), writes, 0, 0);
+    }
+    return 0;
+error:
+    return -1;
+}
+
+static int culling_create_pipeline(Culling *culling, ShaderRegistry *shaders, PipelineCache *cache) {
+    assert_arg(culling);
+    assert_arg(shaders);
+    assert_arg(cache);
+    try(shader_registry_create_module(shaders, culling->device, "cull.comp", &culling->module));
+    VkPushConstantRange push_range = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .size = sizeof(CullingPush),
+    };
+    VkPipelineLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &culling->set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_range,
+    };
+    try(vkCreatePipelineLayout(culling->device, &layout_info, 0, &culling->layout));
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = culling->module,
+            .pName = "main",
+        },
+        .layout = culling->layout,
+        .basePipelineIndex = -1,
+    };
+    try(vkCreateComputePipelines(culling->device, cache->cache, 1, &pipeline_info, 0, &culling->pipeline));
+    return 0;
+error:
+    return -1;
+}
+
+int culling_init(Culling *culling, VkDevice device, GpuMemory *gpu_memory, ShaderRegistry *shaders, PipelineCache *cache, Geometry *geometry, size_t frames_in_flight, PFN_vkCmdDrawIndexedIndirectCountKHR draw_count) {
+    assert_arg(culling);
+    assert_arg(gpu_memory);
+    assert_arg(geometry);
+    culling->device = device;
+    culling->gpu_memory = gpu_memory;
+    culling->geometry = geometry;
+    culling->count = geometry->instance_count;
+    culling->draw_count = draw_count;
+    array_resize(culling->slots, frames_in_flight);
+    memset(culling->slots, 0, sizeof(*culling->slots) * frames_in_flight);
+    for(size_t i = 0; i < frames_in_flight; ++i) {
+        try(culling_create_buffers(culling, array_it(culling->slots, i)));
+    }
+    try(culling_create_descriptors(culling));
+    try(culling_create_pipeline(culling, shaders, cache));
+    return 0;
+error:
+    return -1;
+}
+
+void culling_free(Culling *culling) {
+    assert_arg(culling);
+    VkDevice device = culling->device;
+    vkDestroyPipeline(device, culling->pipeline, 0);
+    vkDestroyPipelineLayout(device, culling->layout, 0);
+    vkDestroyShaderModule(device, culling->module, 0);
+    vkDestroyDescriptorPool(device, culling->descriptor_pool, 0);
+    vkDestroyDescriptorSetLayout(device, culling->set_layout, 0);
+    if(culling->gpu_memory) {
+        for(size_t i = 0; i < array_len(culling->slots); ++i) {
+            CullingSlot *slot = array_it(culling->slots, i);
+            gpu_memory_destroy_buffer(culling->gpu_memory, slot->draws, &slot->draws_allocation);
+            gpu_memory_destroy_buffer(culling->gpu_memory, slot->count, &slot->count_allocation);
+        }
+    }
+    array_free(culling->slots);
+    bool enable = culling->enable;
+    memset(culling, 0, sizeof(*culling));
+    culling->enable = enable;
+}
+
+/* outside of the rendering. the slot's previous draw completed with its frame */
+void culling_dispatch(Culling *culling, VkCommandBuffer command_buffer, size_t slot, const float frustum[4]) {
+    assert_arg(culling);
+    assert_arg(frustum);
+    CullingSlot *s = array_it(culling->slots, slot);
+    if(culling->draw_count) {
+        vkCmdFillBuffer(command_buffer, s->count, 0, VK_WHOLE_SIZE, 0);
+        VkBufferMemoryBarrier clear = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = s->count,
+            .size = VK_WHOLE_SIZE,
+        };
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                0, 0, 1, &clear, 0, 0);
+    }
+    CullingPush push = {
+        .frustum = { frustum[0], frustum[1], frustum[2], frustum[3] },
+        .count = culling->count,
+        .compact = culling->draw_count != 0,
+        .radius = CULLING_RADIUS,
+        .index_count = culling->geometry->index_count,
+    };
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling->pipeline);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling->layout, 0, 1, &s->set, 0, 0);
+    vkCmdPushConstants(command_buffer, culling->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(command_buffer, (culling->count + CULLING_LOCAL_SIZE - 1) / CULLING_LOCAL_SIZE, 1, 1);
+    VkBufferMemoryBarrier barriers[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = s->draws,
+            .size = VK_WHOLE_SIZE,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = s->count,
+            .size = VK_WHOLE_SIZE,
+        },
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+            0, 0, culling->draw_count ? 2 : 1, barriers, 0, 0);
+}
+
+/* inside the rendering, after culling_dispatch of the same slot */
+void culling_draw(Culling *culling, VkCommandBuffer command_buffer, size_t slot) {
+    assert_arg(culling);
+    CullingSlot *s = array_it(culling->slots, slot);
+    geometry_draw_indirect(culling->geometry, command_buffer, s->draws, s->count, culling->count, culling->draw_count);
+}
@@ -0,0 +1,62 @@
+#ifndef CULLING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "geometry.h"
+#include "gpu_memory.h"
+#include "pipeline_cache.h"
+#include "shader_registry.h"
+#include "util.h"
+
+#define CULLING_LOCAL_SIZE      256     // cull.comp local_size_x
+#define CULLING_RADIUS          0.71f   // the triangle's vertices are within this of its origin
+
+/* push constants of cull.comp */
+typedef struct CullingPush {
+    float frustum[4];           // min.xy, max.xy
+    uint32_t count;
+    uint32_t compact;
+    float radius;
+    uint32_t index_count;
+} CullingPush;
+
+/* written and drawn by the same frame, one per frame in flight */
+typedef struct CullingSlot {
+    VkBuffer draws;             // VkDrawIndexedIndirectCommand per object
+    GpuAllocation draws_allocation;
+    VkBuffer count;             // visible draws, only with draw_count
+    GpuAllocation count_allocation;
+    VkDescriptorSet set;
+} CullingSlot;
+
+/* objects are frustum culled by a compute pass recorded ahead of the frame's
+ * rendering, the draw consumes the commands it wrote. the cpu records the
+ * same two commands for any number of objects. with draw_count the visible
+ * commands are compacted and counted on the gpu, otherwise every object keeps
+ * its command and culled ones draw no instance. compaction appends in whatever
+ * order the invocations finish, the instance sort is not kept */
+typedef struct Culling {
+    bool enable;                // --gpu-cull
+    VkDevice device;
+    GpuMemory *gpu_memory;
+    Geometry *geometry;
+    uint32_t count;             // objects, the instances of the geometry
+    PFN_vkCmdDrawIndexedIndirectCountKHR draw_count;   // VK_KHR_draw_indirect_count, 0 for a fixed count
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool descriptor_pool;
+    VkShaderModule module;
+    VkPipelineLayout layout;
+    VkPipeline pipeline;
+    CullingSlot *slots;
+} Culling;
+
+int culling_init(Culling *culling, VkDevice device, GpuMemory *gpu_memory, ShaderRegistry *shaders, PipelineCache *cache, Geometry *geometry, size_t frames_in_flight, PFN_vkCmdDrawIndexedIndirectCountKHR draw_count);
+void culling_free(Culling *culling);
+void culling_dispatch(Culling *culling, VkCommandBuffer command_buffer, size_t slot, const float frustum[4]);
+void culling_draw(Culling *culling, VkCommandBuffer command_buffer, size_t slot);
+
+#define CULLING_H
+#endif
+
@@ -0,0 +1,56 @@
+#include <rlc/array.h>
+#include "deletion_queue.h"
+
+void deletion_queue_push(DeletionQueue *queue, DeletionEntry entry) {
+    assert_arg(queue);
+    array_push(queue->entries, entry);
+}
+
+static void deletion_entry_destroy(DeletionQueue *queue, DeletionEntry *entry, VkDevice device) {
+    assert_arg(queue);
+    assert_arg(entry);
+    switch(entry->kind) {
+        case DELETION_FRAMEBUFFER: vkDestroyFramebuffer(device, entry->framebuffer, 0); break;
+        case DELETION_IMAGE_VIEW: vkDestroyImageView(device, entry->image_view, 0); break;
+        case DELETION_SWAP_CHAIN: vkDestroySwapchainKHR(device, entry->swap_chain, 0); break;
+        case DELETION_COMMAND_BUFFER: vkFreeCommandBuffers(device, entry->command_buffer.pool, 1, &entry->command_buffer.buffer); break;
+        case DELETION_IMAGE: gpu_memory_destroy_image(queue->gpu_memory, entry->image.image, &entry->image.allocation); break;
+    }
+}
+
+void deletion_queue_flush(DeletionQueue *queue, VkDevice device, uint64_t completed) {
+    assert_arg(queue);
+    if(!array_len(queue->entries)) return;
+    /* completed is the frame timeline value: frames below it finished on the gpu */
+    for(size_t i = 0; i < array_len(queue->entries); ++i) {
+        DeletionEntry *entry = array_it(queue->entries, i);
+        if(entry->kind != DELETION_SWAP_CHAIN || entry->frame >= completed) continue;
+        /* the presentation engine may still hold its images, only on recreation */
+        if(queue->present_queue) vkQueueWaitIdle(queue->present_queue);
+        break;
+    }
+    size_t kept = 0;
+    for(size_t i = 0; i < array_len(queue->entries); ++i) {
+        DeletionEntry *entry = array_it(queue->entries, i);
+        if(entry->frame < completed) {
+            deletion_entry_destroy(queue, entry, device);
+        } else {
+            *array_it(queue->entries, kept++) = *entry;
+        }
+    }
+    array_resize(queue->entries, kept);
+}
+
+void deletion_queue_flush_all(DeletionQueue *queue, VkDevice device) {
+    assert_arg(queue);
+    for(size_t i = 0; i < array_len(queue->entries); ++i) {
+        deletion_entry_destroy(queue, array_it(queue->entries, i), device);
+    }
+    array_clear(queue->entries);
+}
+
+void deletion_queue_free(DeletionQueue *queue) {
+    assert_arg(queue);
+    array_free(queue->entries);
+}
+
@@ -0,0 +1,49 @@
+#ifndef DELETION_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "gpu_memory.h"
+#include "util.h"
+
+typedef enum {
+    DELETION_FRAMEBUFFER,
+    DELETION_IMAGE_VIEW,
+    DELETION_SWAP_CHAIN,
+    DELETION_COMMAND_BUFFER,
+    DELETION_IMAGE,
+} DeletionKind;
+
+typedef struct DeletionEntry {
+    DeletionKind kind;
+    size_t frame;   // last frame that may still use the object
+    union {
+        VkFramebuffer framebuffer;
+        VkImageView image_view;
+        VkSwapchainKHR swap_chain;
+        struct {
+            VkCommandPool pool;
+            VkCommandBuffer buffer;
+        } command_buffer;
+        struct {
+            VkImage image;
+            GpuAllocation allocation;
+        } image;
+    };
+} DeletionEntry;
+
+/* objects retired while the gpu may still use them, destroyed once their frame completed */
+typedef struct DeletionQueue {
+    DeletionEntry *entries;
+    GpuMemory *gpu_memory;  // frees DELETION_IMAGE
+    VkQueue present_queue;  // waited idle before DELETION_SWAP_CHAIN, the frame timeline doesn't cover presents
+} DeletionQueue;
+
+void deletion_queue_push(DeletionQueue *queue, DeletionEntry entry);
+void deletion_queue_flush(DeletionQueue *queue, VkDevice device, uint64_t completed);
+void deletion_queue_flush_all(DeletionQueue *queue, VkDevice device);
+void deletion_queue_free(DeletionQueue *queue);
+
+#define DELETION_QUEUE_H
+#endif
+
@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rlc/array.h>
+#include "device_profile.h"
+
+/* each one available adds to the score */
+static const char *device_profile_optional[] = {
+    VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME,
+    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+    VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+};
+
+static int compare_str(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+bool device_profile_has_extension(DeviceProfile *profile, const char *name) {
+    assert_arg(profile);
+    assert_arg(name);
+    if(!array_len(profile->extensions)) return false;
+    return bsearch(&name, profile->extensions, array_len(profile->extensions), sizeof(*profile->extensions), compare_str);
+}
+
+bool device_profile_has_extensions(DeviceProfile *profile, const char **names) {
+    assert_arg(profile);
+    for(size_t i = 0; i < array_len(names); ++i) {
+        if(!device_profile_has_extension(profile, array_at(names, i))) return false;
+    }
+    return true;
+}
+
+int64_t device_profile_score(DeviceProfile *profile, bool present_required) {
+    assert_arg(profile);
+    int64_t score = 0;
+    switch(profile->type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score += 10000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score += 5000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score += 2000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: score += 1000; break;
+        default: break;
+    }
+    /* a point per 64 MiB, never enough to outrank a better device type */
+    VkDeviceSize heap = profile->device_local >> 26;
+    score += heap < 4000 ? (int64_t)heap : 4000;
+    if(profile->dedicated_transfer) score += 200;
+    if(profile->async_compute) score += 200;
+    for(size_t i = 0; i < sizearray(device_profile_optional); ++i) {
+        if(device_profile_has_extension(profile, device_profile_optional[i])) score += 50;
+    }
+    /* the cached answer may be from another display, still try it last */
+    if(present_required && profile->present_queried && !profile->present_families) score -= 100000;
+    return score;
+}
+
+const char *device_profile_type_str(VkPhysicalDeviceType type) {
+    switch(type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+        default: break;
+    }
+    return "other";
+}
+
+static void device_profile_free(DeviceProfile *profile) {
+    assert_arg(profile);
+    for(size_t i = 0; i < array_len(profile->extensions); ++i) {
+        free(array_at(profile->extensions, i));
+    }
+    array_free(profile->extensions);
+}
+
+static void device_profile_query(DeviceProfile *profile, VkPhysicalDevice device, VkPhysicalDeviceProperties *properties) {
+    assert_arg(profile);
+    assert_arg(properties);
+    profile->device = device;
+    profile->vendor_id = properties->vendorID;
+    profile->device_id = properties->deviceID;
+    profile->driver_version = properties->driverVersion;
+    profile->api_version = properties->apiVersion;
+    memcpy(profile->uuid, properties->pipelineCacheUUID, VK_UUID_SIZE);
+    profile->type = properties->deviceType;
+    memcpy(profile->name, properties->deviceName, sizeof(profile->name));
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(device, &memory_properties);
+    for(uint32_t i = 0; i < memory_properties.memoryHeapCount; ++i) {
+        VkMemoryHeap heap = memory_properties.memoryHeaps[i];
+        if(!(heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+        if(heap.size > profile->device_local) profile->device_local = heap.size;
+    }
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, 0);
+    VkQueueFamilyProperties *queue_families = {0};
+    array_resize(queue_families, queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, queue_families);
+    profile->queue_families = queue_family_count;
+    for(size_t i = 0; i < array_len(queue_families); ++i) {
+        VkQueueFlags flags = array_at(queue_families, i).queueFlags;
+        if((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            profile->dedicated_transfer = true;
+        }
+        if((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+            profile->async_compute = true;
+        }
+    }
+    array_free(queue_families);
+    uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(device, 0, &extension_count, 0);
+    VkExtensionProperties *extension_properties = {0};
+    array_resize(extension_properties, extension_count);
+    vkEnumerateDeviceExtensionProperties(device, 0, &extension_count, extension_properties);
+    for(size_t i = 0; i < array_len(extension_properties); ++i) {
+        array_push(profile->extensions, strdup(array_it(extension_properties, i)->extensionName));
+    }
+    array_free(extension_properties);
+    if(array_len(profile->extensions)) {
+        qsort(profile->extensions, array_len(profile->extensions), sizeof(*profile->extensions), compare_str);
+    }
+}
+
+static void device_profile_query_present(DeviceProfile *profile, VkPhysicalDevice device, VkSurfaceKHR surface) {
+    assert_arg(profile);
+    profile->present_families = 0;
+    for(uint32_t i = 0; i < profile->queue_families && i < 64; ++i) {
+        VkBool32 present_support = false;
+        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
+        if(present_support) profile->present_families |= (uint64_t)1 << i;
+    }
+    profile->present_queried = true;
+}
+
+static bool device_profile_matches(DeviceProfile *profile, VkPhysicalDeviceProperties *properties) {
+    assert_arg(profile);
+    assert_arg(properties);
+    if(profile->vendor_id != properties->vendorID) return false;
+    if(profile->device_id != properties->deviceID) return false;
+    if(profile->driver_version != properties->driverVersion) return false;
+    return !memcmp(profile->uuid, properties->pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+size_t device_cache_resolve(DeviceCache *cache, VkPhysicalDevice device, VkSurfaceKHR surface) {
+    assert_arg(cache);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    size_t index = array_len(cache->profiles);
+    for(size_t i = 0; i < array_len(cache->profiles); ++i) {
+        DeviceProfile *profile = array_it(cache->profiles, i);
+        /* two identical gpus share a profile, the first one unclaimed gets it */
+        if(profile->device || !device_profile_matches(profile, &properties)) continue;
+        index = i;
+        break;
+    }
+    if(index < array_len(cache->profiles)) {
+        ++cache->hits;
+        array_it(cache->profiles, index)->device = device;
+    } else {
+        ++cache->misses;
+        DeviceProfile profile = {0};
+        device_profile_query(&profile, device, &properties);
+        array_push(cache->profiles, profile);
+        cache->dirty = true;
+    }
+    DeviceProfile *profile = array_it(cache->profiles, index);
+    if(surface && !profile->present_queried) {
+        device_profile_query_present(profile, device, surface);
+        cache->dirty = true;
+    }
+    return index;
+}
+
+static void device_cache_clear(DeviceCache *cache) {
+    assert_arg(cache);
+    for(size_t i = 0; i < array_len(cache->profiles); ++i) {
+        device_profile_free(array_it(cache->profiles, i));
+    }
+    array_clear(cache->profiles);
+}
+
+static void strip_newline(char *line) {
+    assert_arg(line);
+    line[strcspn(line, "\r\n")] = 0;
+}
+
+int device_cache_load(DeviceCache *cache) {
+    assert_arg(cache);
+    assert_arg(cache->path);
+    FILE *file = fopen(cache->path, "r");
+    if(!file) return 0;
+    char line[512];
+    int version = 0;
+    if(!fgets(line, sizeof(line), file) || sscanf(line, "c-vulkan-device-cache %d", &version) != 1 || version != DEVICE_CACHE_VERSION) {
+        goto stale;
+    }
+    while(fgets(line, sizeof(line), file)) {
+        DeviceProfile profile = {0};
+        char uuid[2 * VK_UUID_SIZE + 1] = {0};
+        unsigned int type = 0, dedicated_transfer = 0, async_compute = 0, present_queried = 0;
+        unsigned long long device_local = 0, present_families = 0;
+        size_t extension_count = 0;
+        int name_at = 0;
+        if(sscanf(line, "device %u %u %u %u %32s %u %llu %u %u %u %u %llx %zu %n",
+                    &profile.vendor_id, &profile.device_id, &profile.driver_version, &profile.api_version,
+                    uuid, &type, &device_local, &profile.queue_families,
+                    &dedicated_transfer, &async_compute, &present_queried, &present_families,
+                    &extension_count, &name_at) != 13 || !name_at) {
+            goto stale;
+        }
+        for(size_t i = 0; i < VK_UUID_SIZE; ++i) {
+            unsigned int byte = 0;
+            if(sscanf(uuid + 2 * i, "%2x", &byte) != 1) goto stale;
+            profile.uuid[i] = (uint8_t)byte;
+        }
+        strip_newline(line + name_at);
+        snprintf(profile.name, sizeof(profile.name), "%s", line + name_at);
+        profile.type = (VkPhysicalDeviceType)type;
+        profile.device_local = device_local;
+        profile.dedicated_transfer = dedicated_transfer;
+        profile.async_compute = async_compute;
+        profile.present_queried = present_queried;
+        profile.present_families = present_families;
+        for(size_t i = 0; i < extension_count; ++i) {
+            if(!fgets(line, sizeof(line), file)) {
+                device_profile_free(&profile);
+                goto stale;
+            }
+            strip_newline(line);
+            array_push(profile.extensions, strdup(line));
+        }
+        array_push(cache->profiles, profile);
+    }
+    fclose(file);
+    return 0;
+stale:
+    /* unreadable or older format, query everything again */
+    device_cache_clear(cache);
+    cache->dirty = true;
+    fclose(file);
+    return 0;
+}
+
+int device_cache_save(DeviceCache *cache) {
+    assert_arg(cache);
+    assert_arg(cache->path);
+    if(!cache->dirty) return 0;
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache->path);
+    FILE *file = fopen(tmp_path, "w");
+    if(!file) return -1;
+    fprintf(file, "c-vulkan-device-cache %d\n", DEVICE_CACHE_VERSION);
+    for(size_t i = 0; i < array_len(cache->profiles); ++i) {
+        DeviceProfile *profile = array_it(cache->profiles, i);
+        char uuid[2 * VK_UUID_SIZE + 1];
+        for(size_t j = 0; j < VK_UUID_SIZE; ++j) {
+            snprintf(uuid + 2 * j, 3, "%02x", profile->uuid[j]);
+        }
+        fprintf(file, "device %u %u %u %u %s %u %llu %u %u %u %u %llx %zu %s\n",
+                profile->vendor_id, profile->device_id, profile->driver_version, profile->api_version,
+                uuid, (unsigned int)profile->type, (unsigned long long)profile->device_local, profile->queue_families,
+                profile->dedicated_transfer, profile->async_compute, profile->present_queried,
+                (unsigned long long)profile->present_families,
+                array_len(profile->extensions), profile->name);
+        for(size_t j = 0; j < array_len(profile->extensions); ++j) {
+            fprintf(file, "%s\n", array_at(profile->extensions, j));
+        }
+    }
+    if(fclose(file) || rename(tmp_path, cache->path)) {
+        remove(tmp_path);
+        return -1;
+    }
+    cache->dirty = false;
+    return 0;
+}
+
+void device_cache_free(DeviceCache *cache) {
+    assert_arg(cache);
+    device_cache_clear(cache);
+    array_free(cache->profiles);
+}
+
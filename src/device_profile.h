@@ -0,0 +1,50 @@
+#ifndef DEVICE_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "util.h"
+
+#define DEVICE_CACHE_VERSION    1
+
+/* everything device selection needs, queried once per driver version */
+typedef struct DeviceProfile {
+    VkPhysicalDevice device;        // not cached, 0 if not present this run
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint32_t api_version;
+    uint8_t uuid[VK_UUID_SIZE];     // pipelineCacheUUID
+    VkPhysicalDeviceType type;
+    char name[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+    VkDeviceSize device_local;      // largest device local heap
+    uint32_t queue_families;
+    bool dedicated_transfer;        // transfer only family
+    bool async_compute;             // compute without graphics family
+    bool present_queried;
+    uint64_t present_families;      // bit per family that can present to the surface
+    char **extensions;              // sorted
+} DeviceProfile;
+
+typedef struct DeviceCache {
+    const char *path;
+    DeviceProfile *profiles;
+    size_t hits;
+    size_t misses;
+    bool dirty;
+} DeviceCache;
+
+bool device_profile_has_extension(DeviceProfile *profile, const char *name);
+bool device_profile_has_extensions(DeviceProfile *profile, const char **names);
+int64_t device_profile_score(DeviceProfile *profile, bool present_required);
+const char *device_profile_type_str(VkPhysicalDeviceType type);
+
+int device_cache_load(DeviceCache *cache);
+int device_cache_save(DeviceCache *cache);
+size_t device_cache_resolve(DeviceCache *cache, VkPhysicalDevice device, VkSurfaceKHR surface);
+void device_cache_free(DeviceCache *cache);
+
+#define DEVICE_PROFILE_H
+#endif
+
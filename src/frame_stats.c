@@ -0,0 +1,205 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <rlc/array.h>
+#include "frame_stats.h"
+
+static const char *frame_stat_names[FRAME_STAT__COUNT] = {
+    [FRAME_STAT_FENCE] = "fence",
+    [FRAME_STAT_ACQUIRE] = "acquire",
+    [FRAME_STAT_RECORD] = "record",
+    [FRAME_STAT_SUBMIT] = "submit",
+    [FRAME_STAT_PRESENT] = "present",
+    [FRAME_STAT_FRAME] = "frame",
+    [FRAME_STAT_INTERVAL] = "interval",
+    [FRAME_STAT_GPU] = "gpu",
+    [FRAME_STAT_RECREATE] = "recreate",
+    [FRAME_STAT_DISPLAY_BY] = "display_by",
+    [FRAME_STAT_COMPUTE] = "compute",
+    [FRAME_STAT_OVERLAP] = "overlap",
+};
+
+double frame_stats_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+void frame_stats_init(FrameStats *stats, size_t capacity) {
+    assert_arg(stats);
+    memset(stats, 0, sizeof(*stats));
+    stats->capacity = capacity ? capacity : FRAME_STATS_CAPACITY;
+    array_resize(stats->samples, stats->capacity);
+}
+
+void frame_stats_free(FrameStats *stats) {
+    assert_arg(stats);
+    array_free(stats->samples);
+    memset(stats, 0, sizeof(*stats));
+}
+
+static FrameStatsSample *frame_stats_sample(FrameStats *stats, size_t frame) {
+    assert_arg(stats);
+    if(!stats->capacity) return 0;
+    if(frame >= stats->frames) return 0;
+    if(stats->frames - frame > stats->capacity) return 0;
+    return array_it(stats->samples, frame % stats->capacity);
+}
+
+void frame_stats_begin(FrameStats *stats) {
+    assert_arg(stats);
+    if(!stats->capacity) return;
+    double now = frame_stats_now();
+    FrameStatsSample *sample = array_it(stats->samples, stats->frames % stats->capacity);
+    for(size_t i = 0; i < FRAME_STAT__COUNT; ++i) {
+        sample->ms[i] = NAN;
+    }
+    sample->skipped = false;
+    if(stats->frames) {
+        sample->ms[FRAME_STAT_INTERVAL] = (now - stats->t_begin) * 1e3;
+    }
+    ++stats->frames;
+    stats->t_begin = now;
+    stats->t_mark = now;
+}
+
+void frame_stats_mark(FrameStats *stats, FrameStat stat) {
+    assert_arg(stats);
+    assert(stat < FRAME_STAT__COUNT);
+    if(!stats->frames) return;
+    double now = frame_stats_now();
+    frame_stats_set(stats, stats->frames - 1, stat, (now - stats->t_mark) * 1e3);
+    stats->t_mark = now;
+}
+
+void frame_stats_end(FrameStats *stats) {
+    assert_arg(stats);
+    if(!stats->frames) return;
+    double now = frame_stats_now();
+    frame_stats_set(stats, stats->frames - 1, FRAME_STAT_FRAME, (now - stats->t_begin) * 1e3);
+}
+
+/* the current frame bailed out before submitting, keep it out of the percentiles */
+void frame_stats_skip(FrameStats *stats) {
+    assert_arg(stats);
+    if(!stats->frames) return;
+    FrameStatsSample *sample = frame_stats_sample(stats, stats->frames - 1);
+    if(!sample || sample->skipped) return;
+    sample->skipped = true;
+    ++stats->skipped;
+}
+
+void frame_stats_set(FrameStats *stats, size_t frame, FrameStat stat, double ms) {
+    assert_arg(stats);
+    assert(stat < FRAME_STAT__COUNT);
+    FrameStatsSample *sample = frame_stats_sample(stats, frame);
+    if(!sample) return;
+    sample->ms[stat] = ms;
+}
+
+const char *frame_stats_name(FrameStat stat) {
+    assert(stat < FRAME_STAT__COUNT);
+    return frame_stat_names[stat];
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(double *sorted, size_t count, double q) {
+    return sorted[(size_t)(q * (double)(count - 1) + 0.5)];
+}
+
+void frame_stats_summary(FrameStats *stats, FrameStat stat, FrameStatsSummary *summary) {
+    assert_arg(stats);
+    assert_arg(summary);
+    assert(stat < FRAME_STAT__COUNT);
+    memset(summary, 0, sizeof(*summary));
+    size_t first = stats->frames > stats->capacity ? stats->frames - stats->capacity : 0;
+    double *sorted = {0};
+    double sum = 0;
+    for(size_t i = first; i < stats->frames; ++i) {
+        FrameStatsSample *sample = frame_stats_sample(stats, i);
+        if(sample->skipped && stat != FRAME_STAT_RECREATE) continue;
+        double ms = sample->ms[stat];
+        if(isnan(ms)) continue;
+        array_push(sorted, ms);
+        sum += ms;
+    }
+    summary->count = array_len(sorted);
+    if(summary->count) {
+        qsort(sorted, summary->count, sizeof(*sorted), compare_double);
+        summary->min = array_at(sorted, 0);
+        summary->p50 = percentile(sorted, summary->count, 0.50);
+        summary->p95 = percentile(sorted, summary->count, 0.95);
+        summary->p99 = percentile(sorted, summary->count, 0.99);
+        summary->max = array_at(sorted, summary->count - 1);
+        summary->mean = sum / (double)summary->count;
+    }
+    array_free(sorted);
+}
+
+void frame_stats_print(FrameStats *stats) {
+    assert_arg(stats);
+    println("%-10s %8s %9s %9s %9s %9s %9s %9s", "[ms]", "count", "min", "p50", "p95", "p99", "max", "mean");
+    for(size_t i = 0; i < FRAME_STAT__COUNT; ++i) {
+        FrameStatsSummary s;
+        frame_stats_summary(stats, i, &s);
+        if(!s.count) continue;
+        println("%-10s %8zu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f", frame_stats_name(i),
+                s.count, s.min, s.p50, s.p95, s.p99, s.max, s.mean);
+    }
+}
+
+int frame_stats_write_json(FrameStats *stats, const char *path) {
+    assert_arg(stats);
+    assert_arg(path);
+    FILE *file = fopen(path, "w");
+    if(!file) {
+        println("failed to open '%s' for writing", path);
+        return -1;
+    }
+    fprintf(file, "{\n  \"frames\": %zu,\n  \"skipped\": %zu,\n  \"unit\": \"ms\",\n  \"stats\": {", stats->frames, stats->skipped);
+    bool first = true;
+    for(size_t i = 0; i < FRAME_STAT__COUNT; ++i) {
+        FrameStatsSummary s;
+        frame_stats_summary(stats, i, &s);
+        if(!s.count) continue;
+        fprintf(file, "%s\n    \"%s\": {\"count\": %zu, \"min\": %.6f, \"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f, \"max\": %.6f, \"mean\": %.6f}",
+                first ? "" : ",", frame_stats_name(i),
+                s.count, s.min, s.p50, s.p95, s.p99, s.max, s.mean);
+        first = false;
+    }
+    fprintf(file, "\n  }\n}\n");
+    return fclose(file) ? -1 : 0;
+}
+
+int frame_stats_write_csv(FrameStats *stats, const char *path) {
+    assert_arg(stats);
+    assert_arg(path);
+    FILE *file = fopen(path, "w");
+    if(!file) {
+        println("failed to open '%s' for writing", path);
+        return -1;
+    }
+    fprintf(file, "frame");
+    for(size_t i = 0; i < FRAME_STAT__COUNT; ++i) {
+        fprintf(file, ",%s_ms", frame_stats_name(i));
+    }
+    fprintf(file, ",skipped\n");
+    size_t first = stats->frames > stats->capacity ? stats->frames - stats->capacity : 0;
+    for(size_t f = first; f < stats->frames; ++f) {
+        FrameStatsSample *sample = frame_stats_sample(stats, f);
+        fprintf(file, "%zu", f);
+        for(size_t i = 0; i < FRAME_STAT__COUNT; ++i) {
+            if(isnan(sample->ms[i])) fprintf(file, ",");
+            else fprintf(file, ",%.6f", sample->ms[i]);
+        }
+        fprintf(file, ",%d\n", sample->skipped);
+    }
+    return fclose(file) ? -1 : 0;
+}
+
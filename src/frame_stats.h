@@ -0,0 +1,66 @@
+#ifndef FRAME_STATS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "util.h"
+
+#define FRAME_STATS_CAPACITY    16384
+
+typedef enum {
+    FRAME_STAT_FENCE,       // wait for the in flight fence
+    FRAME_STAT_ACQUIRE,     // acquire swap chain image
+    FRAME_STAT_RECORD,      // reset and record command buffer
+    FRAME_STAT_SUBMIT,      // queue submit
+    FRAME_STAT_PRESENT,     // queue present
+    FRAME_STAT_FRAME,       // whole app_render
+    FRAME_STAT_INTERVAL,    // start of previous frame to start of this frame
+    FRAME_STAT_GPU,         // render pass on the gpu, from timestamp queries
+    FRAME_STAT_RECREATE,    // swap chain recreation, only on frames that did it
+    FRAME_STAT_DISPLAY_BY,  // queue present until it was seen on screen, from VK_KHR_present_wait, exact only with --pacing latency
+    FRAME_STAT_COMPUTE,     // particle step on the gpu, from timestamp queries
+    FRAME_STAT_OVERLAP,     // part of the particle step overlapping the previous frame's gpu time
+    /* add above */
+    FRAME_STAT__COUNT,
+} FrameStat;
+
+typedef struct FrameStatsSample {
+    double ms[FRAME_STAT__COUNT]; // NAN if not measured
+    bool skipped;               // never submitted, only FRAME_STAT_RECREATE is summarized
+} FrameStatsSample;
+
+typedef struct FrameStatsSummary {
+    size_t count;
+    double min;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+    double mean;
+} FrameStatsSummary;
+
+typedef struct FrameStats {
+    FrameStatsSample *samples;  // ring buffer, keeps the most recent frames
+    size_t capacity;
+    size_t frames;              // total frames begun
+    size_t skipped;             // of which never submitted
+    double t_begin;
+    double t_mark;
+} FrameStats;
+
+double frame_stats_now(void);
+void frame_stats_init(FrameStats *stats, size_t capacity);
+void frame_stats_free(FrameStats *stats);
+void frame_stats_begin(FrameStats *stats);
+void frame_stats_mark(FrameStats *stats, FrameStat stat);
+void frame_stats_end(FrameStats *stats);
+void frame_stats_skip(FrameStats *stats);
+void frame_stats_set(FrameStats *stats, size_t frame, FrameStat stat, double ms);
+const char *frame_stats_name(FrameStat stat);
+void frame_stats_summary(FrameStats *stats, FrameStat stat, FrameStatsSummary *summary);
+void frame_stats_print(FrameStats *stats);
+int frame_stats_write_json(FrameStats *stats, const char *path);
+int frame_stats_write_csv(FrameStats *stats, const char *path);
+
+#define FRAME_STATS_H
+#endif
+
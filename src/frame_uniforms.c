@@ -0,0 +1,138 @@
+#include <string.h>
+#include <rlc/array.h>
+#include "frame_uniforms.h"
+
+int frame_uniforms_init(FrameUniforms *uniforms, VkDevice device) {
+    assert_arg(uniforms);
+    uniforms->device = device;
+    VkDescriptorSetLayoutBinding binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+    };
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings = &binding,
+    };
+    try(vkCreateDescriptorSetLayout(device, &layout_info, 0, &uniforms->set_layout));
+    VkDescriptorPoolSize pool_size = {
+        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .descriptorCount = 1,
+    };
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size,
+    };
+    try(vkCreateDescriptorPool(device, &pool_info, 0, &uniforms->pool));
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = uniforms->pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &uniforms->set_layout,
+    };
+    try(vkAllocateDescriptorSets(device, &alloc_info, &uniforms->set));
+    return 0;
+error:
+    return -1;
+}
+
+/* host visible and coherent is required, device local is preferred (resizable bar) */
+int frame_uniforms_create_buffer(FrameUniforms *uniforms, GpuMemory *gpu_memory, VkDeviceSize alignment, size_t frames_in_flight, VkDeviceSize size) {
+    assert_arg(uniforms);
+    assert_arg(gpu_memory);
+    uniforms->gpu_memory = gpu_memory;
+    uniforms->alignment = alignment ? alignment : 1;
+    uniforms->region = (size + uniforms->alignment - 1) / uniforms->alignment * uniforms->alignment;
+    size_t regions = frames_in_flight + 1;
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = uniforms->region * regions,
+        .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    try(gpu_memory_create_buffer(gpu_memory, &buffer_info, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &uniforms->buffer, &uniforms->allocation));
+    if(!uniforms->allocation.mapped) {
+        println("frame uniforms are not mapped");
+        goto error;
+    }
+    /* each region is its own view of the allocation, so offsets start at 0 */
+    array_resize(uniforms->regions, regions);
+    for(size_t i = 0; i < regions; ++i) {
+        GpuAllocation region = uniforms->allocation;
+        region.offset += uniforms->region * i;
+        region.size = uniforms->region;
+        region.mapped = (unsigned char *)uniforms->allocation.mapped + uniforms->region * i;
+        gpu_linear_init(array_it(uniforms->regions, i), region);
+    }
+    VkDescriptorBufferInfo buffer_desc = {
+        .buffer = uniforms->buffer,
+        .offset = 0,
+        .range = sizeof(FrameData),
+    };
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = uniforms->set,
+        .dstBinding = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .pBufferInfo = &buffer_desc,
+    };
+    vkUpdateDescriptorSets(uniforms->device, 1, &write, 0, 0);
+    return 0;
+error:
+    return -1;
+}
+
+void frame_uniforms_free(FrameUniforms *uniforms) {
+    assert_arg(uniforms);
+    vkDestroyDescriptorPool(uniforms->device, uniforms->pool, 0);
+    vkDestroyDescriptorSetLayout(uniforms->device, uniforms->set_layout, 0);
+    if(uniforms->gpu_memory && uniforms->buffer) {
+        gpu_memory_destroy_buffer(uniforms->gpu_memory, uniforms->buffer, &uniforms->allocation);
+    }
+    array_free(uniforms->regions);
+    memset(uniforms, 0, sizeof(*uniforms));
+}
+
+/* the frame's previous use of the region completed */
+void frame_uniforms_begin(FrameUniforms *uniforms, size_t frame) {
+    assert_arg(uniforms);
+    gpu_linear_reset(array_it(uniforms->regions, frame));
+}
+
+static int frame_uniforms_write(FrameUniforms *uniforms, size_t region, const void *data, VkDeviceSize size, uint32_t *offset) {
+    assert_arg(uniforms);
+    assert_arg(data);
+    assert_arg(offset);
+    GpuLinear *linear = array_it(uniforms->regions, region);
+    VkDeviceSize at = 0;
+    if(gpu_linear_alloc(linear, size, uniforms->alignment, &at)) {
+        println("frame uniforms region of %zu bytes is full", (size_t)uniforms->region);
+        return -1;
+    }
+    memcpy((unsigned char *)linear->allocation.mapped + at, data, size);
+    *offset = (uint32_t)(uniforms->region * region + at);
+    return 0;
+}
+
+/* offset is the dynamic offset to bind the data with */
+int frame_uniforms_push(FrameUniforms *uniforms, size_t frame, const void *data, VkDeviceSize size, uint32_t *offset) {
+    assert_arg(uniforms);
+    return frame_uniforms_write(uniforms, frame, data, size, offset);
+}
+
+/* never reset, for command buffers recorded once and replayed */
+int frame_uniforms_push_static(FrameUniforms *uniforms, const void *data, VkDeviceSize size, uint32_t *offset) {
+    assert_arg(uniforms);
+    return frame_uniforms_write(uniforms, array_len(uniforms->regions) - 1, data, size, offset);
+}
+
+void frame_uniforms_bind(FrameUniforms *uniforms, VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t set, uint32_t offset) {
+    assert_arg(uniforms);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set, 1, &uniforms->set, 1, &offset);
+}
@@ -0,0 +1,46 @@
+#ifndef FRAME_UNIFORMS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "gpu_memory.h"
+#include "util.h"
+
+#define FRAME_UNIFORMS_SIZE     ((VkDeviceSize)64 << 10)    // per frame in flight
+
+/* FrameData of shader.vert, std140 */
+typedef struct FrameData {
+    float view[4];              // camera center.xy, zoom, unused
+    float time[4];              // seconds since start, delta, frame, unused
+} FrameData;
+
+/* one persistently mapped, host coherent buffer split into a region per
+ * frame in flight plus a static one. each region is a bump allocator reset
+ * when its frame starts, the caller waited for the last frame that used it.
+ * writing is a pointer bump and a memcpy, the shaders see the data through a
+ * single dynamic uniform buffer descriptor and the offset given at bind */
+typedef struct FrameUniforms {
+    VkDevice device;
+    GpuMemory *gpu_memory;
+    VkDeviceSize alignment;     // minUniformBufferOffsetAlignment
+    VkDeviceSize region;        // bytes per region, a multiple of alignment
+    VkBuffer buffer;
+    GpuAllocation allocation;
+    GpuLinear *regions;         // frames in flight, then the static region
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+} FrameUniforms;
+
+int frame_uniforms_init(FrameUniforms *uniforms, VkDevice device);
+int frame_uniforms_create_buffer(FrameUniforms *uniforms, GpuMemory *gpu_memory, VkDeviceSize alignment, size_t frames_in_flight, VkDeviceSize size);
+void frame_uniforms_free(FrameUniforms *uniforms);
+void frame_uniforms_begin(FrameUniforms *uniforms, size_t frame);
+int frame_uniforms_push(FrameUniforms *uniforms, size_t frame, const void *data, VkDeviceSize size, uint32_t *offset);
+int frame_uniforms_push_static(FrameUniforms *uniforms, const void *data, VkDeviceSize size, uint32_t *offset);
+void frame_uniforms_bind(FrameUniforms *uniforms, VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t set, uint32_t offset);
+
+#define FRAME_UNIFORMS_H
+#endif
+
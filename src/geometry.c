@@ -0,0 +1,331 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "geometry.h"
+
+static const Vertex triangle[] = {
+    {{ 0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+    {{ 0.5f,  0.5f}, {0.0f, 1.0f, 0.0f}},
+    {{-0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}},
+};
+
+static const uint16_t triangle_indices[] = {
+    0, 1, 2,
+};
+
+static const char *geometry_order_names[] = {
+    [GEOMETRY_ORDER_FRONT_TO_BACK] = "front",
+    [GEOMETRY_ORDER_BACK_TO_FRONT] = "back",
+    [GEOMETRY_ORDER_UNSORTED] = "none",
+};
+
+const char *geometry_order_str(GeometryOrder order) {
+    if((size_t)order >= sizearray(geometry_order_names)) return "?";
+    return geometry_order_names[order];
+}
+
+int geometry_order_parse(const char *str, GeometryOrder *order) {
+    assert_arg(str);
+    assert_arg(order);
+    for(size_t i = 0; i < sizearray(geometry_order_names); ++i) {
+        if(strcmp(str, geometry_order_names[i])) continue;
+        *order = (GeometryOrder)i;
+        return 0;
+    }
+    return -1;
+}
+
+/* pipeline in the high half so draws sharing a pipeline stay together, then
+ * depth front to back. depth is in [0, 1], positive floats compare like
+ * their bits so no quantization is needed */
+uint64_t geometry_sort_key(uint32_t pipeline, float depth) {
+    uint32_t bits = 0;
+    if(depth > 0.0f) memcpy(&bits, &depth, sizeof(bits));
+    return ((uint64_t)pipeline << 32) | bits;
+}
+
+void geometry_binding_descriptions(VkVertexInputBindingDescription descriptions[2]) {
+    assert_arg(descriptions);
+    descriptions[0] = (VkVertexInputBindingDescription){
+        .binding = 0,
+        .stride = sizeof(Vertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+    descriptions[1] = (VkVertexInputBindingDescription){
+        .binding = 1,
+        .stride = sizeof(InstanceData),
+        .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+    };
+}
+
+void geometry_attribute_descriptions(VkVertexInputAttributeDescription descriptions[4]) {
+    assert_arg(descriptions);
+    descriptions[0] = (VkVertexInputAttributeDescription){
+        .location = 0,
+        .binding = 0,
+        .format = VK_FORMAT_R32G32_SFLOAT,
+        .offset = offsetof(Vertex, position),
+    };
+    descriptions[1] = (VkVertexInputAttributeDescription){
+        .location = 1,
+        .binding = 0,
+        .format = VK_FORMAT_R32G32B32_SFLOAT,
+        .offset = offsetof(Vertex, color),
+    };
+    descriptions[2] = (VkVertexInputAttributeDescription){
+        .location = 2,
+        .binding = 1,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .offset = offsetof(InstanceData, transform),
+    };
+    descriptions[3] = (VkVertexInputAttributeDescription){
+        .location = 3,
+        .binding = 1,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .offset = offsetof(InstanceData, color),   // color.rgb and depth
+    };
+}
+
+/* square grid over [-spread, spread], a single instance is the plain triangle */
+static void geometry_fill_instances(InstanceData *instances, uint32_t count, float spread) {
+    assert_arg(instances);
+    uint32_t side = (uint32_t)ceil(sqrt((double)count));
+    float cell = 2.0f * spread / (float)side;
+    float scale = side > 1 ? cell * 0.9f : 1.0f;
+    for(uint32_t i = 0; i < count; ++i) {
+        uint32_t x = i % side;
+        uint32_t y = i / side;
+        InstanceData *instance = &instances[i];
+        instance->transform[0] = -spread + cell * ((float)x + 0.5f);
+        instance->transform[1] = -spread + cell * ((float)y + 0.5f);
+        instance->transform[2] = scale;
+        instance->transform[3] = count > 1 ? (float)(i % 16) * 0.39269908f : 0.0f;
+        instance->color[0] = count > 1 ? (float)(x + 1) / (float)side : 1.0f;
+        instance->color[1] = count > 1 ? (float)(y + 1) / (float)side : 1.0f;
+        instance->color[2] = 1.0f;
+        instance->depth = 0.5f;
+    }
+}
+
+/* overdraw benchmark: every layer covers the whole viewport at its own depth */
+static void geometry_fill_layers(InstanceData *instances, uint32_t count) {
+    assert_arg(instances);
+    uint32_t seed = 0x9e3779b9u;
+    for(uint32_t i = 0; i < count; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        InstanceData *instance = &instances[i];
+        instance->transform[0] = 0.0f;
+        instance->transform[1] = 0.0f;
+        instance->transform[2] = 8.0f;   // the triangle at this scale contains the viewport
+        instance->transform[3] = 0.0f;
+        instance->color[0] = (float)(i % 7) / 6.0f;
+        instance->color[1] = (float)(i % 5) / 4.0f;
+        instance->color[2] = (float)(i % 3) / 2.0f;
+        instance->depth = 0.05f + 0.9f * (float)(seed >> 8) / (float)(1u << 24);
+    }
+}
+
+typedef struct GeometrySortItem {
+    uint64_t key;
+    uint32_t index;
+} GeometrySortItem;
+
+static int geometry_sort_cmp(const void *a, const void *b) {
+    uint64_t ka = ((const GeometrySortItem *)a)->key;
+    uint64_t kb = ((const GeometrySortItem *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+/* reorder the instances by their sort key, all of them use the same pipeline */
+static int geometry_sort_instances(InstanceData *instances, uint32_t count, GeometryOrder order) {
+    assert_arg(instances);
+    if(order == GEOMETRY_ORDER_UNSORTED) return 0;
+    int err = 0;
+    GeometrySortItem *items = malloc(sizeof(*items) * count);
+    InstanceData *sorted = malloc(sizeof(*sorted) * count);
+    if(!items || !sorted) goto error;
+    for(uint32_t i = 0; i < count; ++i) {
+        float depth = order == GEOMETRY_ORDER_BACK_TO_FRONT ? 1.0f - instances[i].depth : instances[i].depth;
+        items[i].key = geometry_sort_key(0, depth);
+        items[i].index = i;
+    }
+    qsort(items, count, sizeof(*items), geometry_sort_cmp);
+    for(uint32_t i = 0; i < count; ++i) {
+        sorted[i] = instances[items[i].index];
+    }
+    memcpy(instances, sorted, sizeof(*instances) * count);
+clean:
+    free(items);
+    free(sorted);
+    return err;
+error:
+    err = -1;
+    goto clean;
+}
+
+static int geometry_create_buffer(GpuMemory *gpu_memory, Upload *upload, const void *data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer, GpuAllocation *allocation) {
+    assert_arg(gpu_memory);
+    assert_arg(upload);
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    try(gpu_memory_create_buffer(gpu_memory, &buffer_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, buffer, allocation));
+    try(upload_buffer(upload, *buffer, 0, data, size));
+    return 0;
+error:
+    return -1;
+}
+
+int geometry_create(Geometry *geometry, GpuMemory *gpu_memory, Upload *upload) {
+    assert_arg(geometry);
+    assert_arg(gpu_memory);
+    assert_arg(upload);
+    int err = 0;
+    InstanceData *instances = 0;
+    if(geometry->layers) geometry->instance_count = geometry->layers;
+    if(!geometry->instance_count) geometry->instance_count = 1;
+    if(geometry->instance_count > GEOMETRY_INSTANCES_MAX) {
+        println("%u instances exceed the maximum of %u", geometry->instance_count, GEOMETRY_INSTANCES_MAX);
+        goto error;
+    }
+    geometry->vertex_count = sizearray(triangle);
+    geometry->ticket = upload_ticket(upload);
+    geometry->index_count = sizearray(triangle_indices);
+    if(geometry->spread <= 0.0f) geometry->spread = 1.0f;
+    try(geometry_create_buffer(gpu_memory, upload, triangle, sizeof(triangle), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                &geometry->vertex_buffer, &geometry->vertex_allocation));
+    try(geometry_create_buffer(gpu_memory, upload, triangle_indices, sizeof(triangle_indices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                &geometry->index_buffer, &geometry->index_allocation));
+    instances = malloc(sizeof(*instances) * geometry->instance_count);
+    if(!instances) goto error;
+    if(geometry->layers) {
+        geometry_fill_layers(instances, geometry->instance_count);
+    } else {
+        geometry_fill_instances(instances, geometry->instance_count, geometry->spread);
+    }
+    try(geometry_sort_instances(instances, geometry->instance_count, geometry->order));
+    try(geometry_create_buffer(gpu_memory, upload, instances, sizeof(*instances) * geometry->instance_count,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                &geometry->instance_buffer, &geometry->instance_allocation));
+    /* the acquire is submitted to the graphics queue ahead of the first frame */
+    try(upload_flush(upload));
+clean:
+    free(instances);
+    return err;
+error:
+    err = -1;
+    goto clean;
+}
+
+void geometry_destroy(Geometry *geometry, GpuMemory *gpu_memory) {
+    assert_arg(geometry);
+    assert_arg(gpu_memory);
+    if(geometry->vertex_buffer) {
+        gpu_memory_destroy_buffer(gpu_memory, geometry->vertex_buffer, &geometry->vertex_allocation);
+    }
+    if(geometry->index_buffer) {
+        gpu_memory_destroy_buffer(gpu_memory, geometry->index_buffer, &geometry->index_allocation);
+    }
+    if(geometry->instance_buffer) {
+        gpu_memory_destroy_buffer(gpu_memory, geometry->instance_buffer, &geometry->instance_allocation);
+    }
+    geometry->vertex_buffer = VK_NULL_HANDLE;
+    geometry->index_buffer = VK_NULL_HANDLE;
+    geometry->instance_buffer = VK_NULL_HANDLE;
+}
+
+void geometry_draw(Geometry *geometry, VkCommandBuffer command_buffer) {
+    assert_arg(geometry);
+    geometry_draw_range(geometry, command_buffer, 0, geometry->instance_count);
+}
+
+void geometry_draw_range(Geometry *geometry, VkCommandBuffer command_buffer, uint32_t first_instance, uint32_t instance_count) {
+    assert_arg(geometry);
+    VkBuffer buffers[] = {geometry->vertex_buffer, geometry->instance_buffer};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(command_buffer, 0, sizearray(buffers), buffers, offsets);
+    vkCmdDraw(command_buffer, geometry->vertex_count, instance_count, 0, first_instance);
+}
+
+/* --draws, the instances in this many draw calls of about the same size */
+uint32_t geometry_batches(Geometry *geometry) {
+    assert_arg(geometry);
+    if(!geometry->draws) return 1;
+    return geometry->draws < geometry->instance_count ? geometry->draws : geometry->instance_count;
+}
+
+/* batch == geometry_batches() is the end of the last one */
+uint32_t geometry_batch_first(Geometry *geometry, uint32_t batch) {
+    assert_arg(geometry);
+    return (uint32_t)((uint64_t)geometry->instance_count * batch / geometry_batches(geometry));
+}
+
+/* the instances are split evenly between the materials and into the batches,
+ * one draw per piece overlapping the range and a push constant whenever the
+ * material changes, all with the same texture. no materials draws with the
+ * default tint */
+void geometry_draw_materials(Geometry *geometry, VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t first_instance, uint32_t instance_count, uint32_t texture, const uint32_t *materials, uint32_t material_count) {
+    assert_arg(geometry);
+    VkBuffer buffers[] = {geometry->vertex_buffer, geometry->instance_buffer};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(command_buffer, 0, sizearray(buffers), buffers, offsets);
+    BindlessPush push = {
+        .texture = texture,
+        .material = BINDLESS_DEFAULT,
+    };
+    uint64_t count = geometry->instance_count;
+    uint32_t groups = material_count ? material_count : 1;
+    uint32_t pushed = UINT32_MAX;
+    uint32_t end = first_instance + instance_count;
+    for(uint32_t b = 0; b < geometry_batches(geometry); ++b) {
+        uint32_t batch_lo = geometry_batch_first(geometry, b);
+        uint32_t batch_hi = geometry_batch_first(geometry, b + 1);
+        if(batch_lo < first_instance) batch_lo = first_instance;
+        if(batch_hi > end) batch_hi = end;
+        if(batch_lo >= batch_hi) continue;
+        /* never past the material of the first instance, the loop skips what's before */
+        for(uint32_t i = (uint32_t)(batch_lo * (uint64_t)groups / count); i < groups; ++i) {
+            uint32_t lo = (uint32_t)(count * i / groups);
+            uint32_t hi = (uint32_t)(count * (i + 1) / groups);
+            if(lo >= batch_hi) break;
+            if(lo < batch_lo) lo = batch_lo;
+            if(hi > batch_hi) hi = batch_hi;
+            if(lo >= hi) continue;
+            if(i != pushed) {
+                push.material = material_count ? materials[i] : BINDLESS_DEFAULT;
+                vkCmdPushConstants(command_buffer, layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+                pushed = i;
+            }
+            vkCmdDraw(command_buffer, geometry->vertex_count, hi - lo, 0, lo);
+        }
+    }
+}
+
+/* the vertices of the geometry with instance data from another buffer, e.g. written by a compute shader */
+void geometry_draw_instances(Geometry *geometry, VkCommandBuffer command_buffer, VkBuffer instances, uint32_t instance_count) {
+    assert_arg(geometry);
+    VkBuffer buffers[] = {geometry->vertex_buffer, instances};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(command_buffer, 0, sizearray(buffers), buffers, offsets);
+    vkCmdDraw(command_buffer, geometry->vertex_count, instance_count, 0, 0);
+}
+
+/* draws written by the culling pass, one indexed command per object with
+ * firstInstance selecting its instance. without draw_count every object has
+ * a command and the culled ones draw 0 instances */
+void geometry_draw_indirect(Geometry *geometry, VkCommandBuffer command_buffer, VkBuffer draws, VkBuffer count, uint32_t max_draws, PFN_vkCmdDrawIndexedIndirectCountKHR draw_count) {
+    assert_arg(geometry);
+    VkBuffer buffers[] = {geometry->vertex_buffer, geometry->instance_buffer};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(command_buffer, 0, sizearray(buffers), buffers, offsets);
+    vkCmdBindIndexBuffer(command_buffer, geometry->index_buffer, 0, VK_INDEX_TYPE_UINT16);
+    if(draw_count) {
+        draw_count(command_buffer, draws, 0, count, 0, max_draws, sizeof(VkDrawIndexedIndirectCommand));
+    } else {
+        vkCmdDrawIndexedIndirect(command_buffer, draws, 0, max_draws, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
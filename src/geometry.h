@@ -0,0 +1,64 @@
+#ifndef GEOMETRY_H
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "bindless.h"
+#include "gpu_memory.h"
+#include "upload.h"
+#include "util.h"
+
+#define GEOMETRY_INSTANCES_MAX  (1u << 24)
+
+typedef struct Vertex {
+    float position[2];
+    float color[3];
+} Vertex;
+
+typedef struct InstanceData {
+    float transform[4];     // offset.xy, scale, rotation
+    float color[3];
+    float depth;            // 0 near, 1 far, read with color as one vec4
+} InstanceData;
+
+/* order of the instances in the buffer, one instanced draw keeps it on the gpu */
+typedef enum {
+    GEOMETRY_ORDER_FRONT_TO_BACK,   // early-z rejects what is hidden
+    GEOMETRY_ORDER_BACK_TO_FRONT,   // worst case, every layer is shaded
+    GEOMETRY_ORDER_UNSORTED,
+} GeometryOrder;
+
+typedef struct Geometry {
+    VkBuffer vertex_buffer;
+    GpuAllocation vertex_allocation;
+    uint32_t vertex_count;
+    VkBuffer index_buffer;      // only drawn from indirect commands
+    GpuAllocation index_allocation;
+    uint32_t index_count;
+    VkBuffer instance_buffer;   // also read by the culling pass
+    GpuAllocation instance_allocation;
+    uint32_t instance_count;    // 0 means 1
+    uint32_t draws;             // --draws, the instances are split into this many draw calls, 0 means 1
+    uint32_t layers;            // overdraw scene: screen covering layers instead of the grid
+    float spread;               // half extent of the grid, 0 means 1 (the viewport)
+    GeometryOrder order;
+    uint64_t ticket;            // upload carrying the buffers
+} Geometry;
+
+const char *geometry_order_str(GeometryOrder order);
+int geometry_order_parse(const char *str, GeometryOrder *order);
+uint64_t geometry_sort_key(uint32_t pipeline, float depth);
+void geometry_binding_descriptions(VkVertexInputBindingDescription descriptions[2]);
+void geometry_attribute_descriptions(VkVertexInputAttributeDescription descriptions[4]);
+int geometry_create(Geometry *geometry, GpuMemory *gpu_memory, Upload *upload);
+void geometry_destroy(Geometry *geometry, GpuMemory *gpu_memory);
+void geometry_draw(Geometry *geometry, VkCommandBuffer command_buffer);
+void geometry_draw_range(Geometry *geometry, VkCommandBuffer command_buffer, uint32_t first_instance, uint32_t instance_count);
+uint32_t geometry_batches(Geometry *geometry);
+uint32_t geometry_batch_first(Geometry *geometry, uint32_t batch);
+void geometry_draw_materials(Geometry *geometry, VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t first_instance, uint32_t instance_count, uint32_t texture, const uint32_t *materials, uint32_t material_count);
+void geometry_draw_instances(Geometry *geometry, VkCommandBuffer command_buffer, VkBuffer instances, uint32_t instance_count);
+void geometry_draw_indirect(Geometry *geometry, VkCommandBuffer command_buffer, VkBuffer draws, VkBuffer count, uint32_t max_draws, PFN_vkCmdDrawIndexedIndirectCountKHR draw_count);
+
+#define GEOMETRY_H
+#endif
+
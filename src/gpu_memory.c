@@ -0,0 +1,362 @@
+#include <stdlib.h>
+#include <string.h>
+#include <rlc/array.h>
+#include "gpu_memory.h"
+
+static uint32_t order_for(VkDeviceSize size) {
+    uint32_t order = GPU_MEMORY_MIN_ORDER;
+    while(order < GPU_MEMORY_MAX_ORDER && ((VkDeviceSize)1 << order) < size) ++order;
+    return order;
+}
+
+static uint32_t popcount32(uint32_t x) {
+    uint32_t count = 0;
+    for(; x; x &= x - 1) ++count;
+    return count;
+}
+
+void gpu_memory_init(GpuMemory *memory, VkPhysicalDevice physical, VkDevice device) {
+    assert_arg(memory);
+    memset(memory, 0, sizeof(*memory));
+    memory->device = device;
+    vkGetPhysicalDeviceMemoryProperties(physical, &memory->properties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical, &properties);
+    memory->granularity = properties.limits.bufferImageGranularity;
+    memory->max_allocations = properties.limits.maxMemoryAllocationCount;
+}
+
+static int find_type(GpuMemory *memory, uint32_t type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, uint32_t *type) {
+    assert_arg(memory);
+    assert_arg(type);
+    uint32_t best_score = 0;
+    bool found = false;
+    for(uint32_t i = 0; i < memory->properties.memoryTypeCount; ++i) {
+        if(!(type_bits & (1u << i))) continue;
+        VkMemoryPropertyFlags flags = memory->properties.memoryTypes[i].propertyFlags;
+        if((flags & required) != required) continue;
+        uint32_t score = 1 + popcount32(flags & preferred);
+        if(score <= best_score) continue;
+        best_score = score;
+        *type = i;
+        found = true;
+    }
+    return found ? 0 : -1;
+}
+
+static VkDeviceSize block_size_for(GpuMemory *memory, uint32_t type) {
+    assert_arg(memory);
+    uint32_t heap = memory->properties.memoryTypes[type].heapIndex;
+    VkDeviceSize heap_size = memory->properties.memoryHeaps[heap].size;
+    /* don't let one block take more than an eighth of a small heap */
+    VkDeviceSize size = GPU_MEMORY_BLOCK_SIZE;
+    while(size > ((VkDeviceSize)1 << GPU_MEMORY_MIN_ORDER) && size > heap_size / 8) size >>= 1;
+    return size;
+}
+
+static int device_allocate(GpuMemory *memory, VkDeviceSize size, uint32_t type, VkDeviceMemory *device_memory, void **mapped) {
+    assert_arg(memory);
+    assert_arg(device_memory);
+    assert_arg(mapped);
+    if(memory->max_allocations && memory->device_allocations >= memory->max_allocations) {
+        println("maxMemoryAllocationCount (%u) reached", memory->max_allocations);
+        return -1;
+    }
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = size,
+        .memoryTypeIndex = type,
+    };
+    try(vkAllocateMemory(memory->device, &alloc_info, 0, device_memory));
+    *mapped = 0;
+    if(memory->properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if(vkMapMemory(memory->device, *device_memory, 0, VK_WHOLE_SIZE, 0, mapped)) {
+            vkFreeMemory(memory->device, *device_memory, 0);
+            *device_memory = VK_NULL_HANDLE;
+            goto error;
+        }
+    }
+    ++memory->device_allocations;
+    return 0;
+error:
+    return -1;
+}
+
+static void device_free(GpuMemory *memory, VkDeviceMemory device_memory) {
+    assert_arg(memory);
+    vkFreeMemory(memory->device, device_memory, 0);
+    --memory->device_allocations;
+}
+
+static GpuMemoryBlock *block_create(GpuMemory *memory, uint32_t type, GpuMemoryResource resource) {
+    assert_arg(memory);
+    GpuMemoryBlock *block = malloc(sizeof(*block));
+    if(!block) return 0;
+    memset(block, 0, sizeof(*block));
+    block->size = block_size_for(memory, type);
+    block->max_order = order_for(block->size);
+    block->memory_type = type;
+    block->resource = resource;
+    if(device_allocate(memory, block->size, type, &block->memory, &block->mapped)) {
+        free(block);
+        return 0;
+    }
+    array_push(block->free[block->max_order], 0);
+    array_push(memory->blocks, block);
+    return block;
+}
+
+static void block_destroy(GpuMemory *memory, GpuMemoryBlock *block) {
+    assert_arg(memory);
+    assert_arg(block);
+    device_free(memory, block->memory);
+    for(size_t i = 0; i <= GPU_MEMORY_MAX_ORDER; ++i) {
+        array_free(block->free[i]);
+    }
+    free(block);
+}
+
+static int buddy_alloc(GpuMemoryBlock *block, uint32_t order, VkDeviceSize *offset) {
+    assert_arg(block);
+    assert_arg(offset);
+    if(order > block->max_order) return -1;
+    uint32_t k = order;
+    while(k <= block->max_order && !array_len(block->free[k])) ++k;
+    if(k > block->max_order) return -1;
+    size_t len = array_len(block->free[k]);
+    VkDeviceSize found = array_at(block->free[k], len - 1);
+    array_resize(block->free[k], len - 1);
+    /* split down, the upper halves become free buddies */
+    while(k > order) {
+        --k;
+        array_push(block->free[k], found + ((VkDeviceSize)1 << k));
+    }
+    *offset = found;
+    return 0;
+}
+
+static void buddy_free(GpuMemoryBlock *block, VkDeviceSize offset, uint32_t order) {
+    assert_arg(block);
+    uint32_t k = order;
+    while(k < block->max_order) {
+        VkDeviceSize buddy = offset ^ ((VkDeviceSize)1 << k);
+        size_t len = array_len(block->free[k]);
+        size_t i = 0;
+        for(; i < len; ++i) {
+            if(array_at(block->free[k], i) == buddy) break;
+        }
+        if(i == len) break;
+        /* merge with the free buddy */
+        *array_it(block->free[k], i) = array_at(block->free[k], len - 1);
+        array_resize(block->free[k], len - 1);
+        offset &= ~((VkDeviceSize)1 << k);
+        ++k;
+    }
+    array_push(block->free[k], offset);
+}
+
+static VkDeviceSize block_largest_free(GpuMemoryBlock *block) {
+    assert_arg(block);
+    for(uint32_t k = block->max_order + 1; k > GPU_MEMORY_MIN_ORDER; --k) {
+        if(array_len(block->free[k - 1])) return (VkDeviceSize)1 << (k - 1);
+    }
+    return 0;
+}
+
+int gpu_memory_alloc(GpuMemory *memory, const VkMemoryRequirements *requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, GpuMemoryResource resource, GpuAllocation *allocation) {
+    assert_arg(memory);
+    assert_arg(requirements);
+    assert_arg(allocation);
+    memset(allocation, 0, sizeof(*allocation));
+    uint32_t type = 0;
+    if(find_type(memory, requirements->memoryTypeBits, required | preferred, 0, &type) &&
+       find_type(memory, requirements->memoryTypeBits, required, preferred, &type)) {
+        println("no memory type for flags 0x%x", required);
+        return -1;
+    }
+    allocation->memory_type = type;
+    allocation->size = requirements->size;
+    VkDeviceSize size = requirements->size > requirements->alignment ? requirements->size : requirements->alignment;
+    if(resource == GPU_MEMORY_RESOURCE_DEDICATED || size > block_size_for(memory, type) / 2) {
+        /* too big to share a block, or asked not to */
+        try(device_allocate(memory, requirements->size, type, &allocation->memory, &allocation->mapped));
+        ++memory->dedicated;
+        memory->dedicated_size += allocation->size;
+        memory->requested += allocation->size;
+        return 0;
+    }
+    allocation->order = order_for(size);
+    /* buddies are aligned to their size, so neighbours never share a granularity page */
+    if(memory->granularity <= ((VkDeviceSize)1 << GPU_MEMORY_MIN_ORDER)) {
+        resource = GPU_MEMORY_RESOURCE_LINEAR;
+    }
+    GpuMemoryBlock *block = 0;
+    VkDeviceSize offset = 0;
+    for(size_t i = 0; i < array_len(memory->blocks); ++i) {
+        GpuMemoryBlock *candidate = array_at(memory->blocks, i);
+        if(candidate->memory_type != type || candidate->resource != resource) continue;
+        if(buddy_alloc(candidate, allocation->order, &offset)) continue;
+        block = candidate;
+        break;
+    }
+    if(!block) {
+        block = block_create(memory, type, resource);
+        if(!block) goto error;
+        try(buddy_alloc(block, allocation->order, &offset));
+    }
+    ++block->allocations;
+    block->used += (VkDeviceSize)1 << allocation->order;
+    memory->requested += allocation->size;
+    allocation->block = block;
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->mapped = block->mapped ? (char *)block->mapped + offset : 0;
+    return 0;
+error:
+    return -1;
+}
+
+void gpu_memory_free(GpuMemory *memory, GpuAllocation *allocation) {
+    assert_arg(memory);
+    assert_arg(allocation);
+    if(!allocation->memory) return;
+    memory->requested -= allocation->size;
+    GpuMemoryBlock *block = allocation->block;
+    if(!block) {
+        device_free(memory, allocation->memory);
+        --memory->dedicated;
+        memory->dedicated_size -= allocation->size;
+        memset(allocation, 0, sizeof(*allocation));
+        return;
+    }
+    buddy_free(block, allocation->offset, allocation->order);
+    --block->allocations;
+    block->used -= (VkDeviceSize)1 << allocation->order;
+    memset(allocation, 0, sizeof(*allocation));
+    if(block->allocations) return;
+    /* give an empty block back unless it's the last one of its kind */
+    size_t index = 0, same = 0;
+    for(size_t i = 0; i < array_len(memory->blocks); ++i) {
+        GpuMemoryBlock *other = array_at(memory->blocks, i);
+        if(other == block) index = i;
+        if(other->memory_type == block->memory_type && other->resource == block->resource) ++same;
+    }
+    if(same <= 1) return;
+    size_t len = array_len(memory->blocks);
+    *array_it(memory->blocks, index) = array_at(memory->blocks, len - 1);
+    array_resize(memory->blocks, len - 1);
+    block_destroy(memory, block);
+}
+
+void gpu_memory_free_all(GpuMemory *memory) {
+    assert_arg(memory);
+    for(size_t i = 0; i < array_len(memory->blocks); ++i) {
+        block_destroy(memory, array_at(memory->blocks, i));
+    }
+    array_free(memory->blocks);
+}
+
+int gpu_memory_create_buffer(GpuMemory *memory, const VkBufferCreateInfo *create_info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkBuffer *buffer, GpuAllocation *allocation) {
+    assert_arg(memory);
+    assert_arg(create_info);
+    assert_arg(buffer);
+    assert_arg(allocation);
+    *buffer = VK_NULL_HANDLE;
+    memset(allocation, 0, sizeof(*allocation));
+    try(vkCreateBuffer(memory->device, create_info, 0, buffer));
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(memory->device, *buffer, &requirements);
+    try(gpu_memory_alloc(memory, &requirements, required, preferred, GPU_MEMORY_RESOURCE_LINEAR, allocation));
+    try(vkBindBufferMemory(memory->device, *buffer, allocation->memory, allocation->offset));
+    return 0;
+error:
+    gpu_memory_destroy_buffer(memory, *buffer, allocation);
+    *buffer = VK_NULL_HANDLE;
+    return -1;
+}
+
+void gpu_memory_destroy_buffer(GpuMemory *memory, VkBuffer buffer, GpuAllocation *allocation) {
+    assert_arg(memory);
+    assert_arg(allocation);
+    vkDestroyBuffer(memory->device, buffer, 0);
+    gpu_memory_free(memory, allocation);
+}
+
+int gpu_memory_create_image(GpuMemory *memory, const VkImageCreateInfo *create_info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkImage *image, GpuAllocation *allocation) {
+    assert_arg(memory);
+    assert_arg(create_info);
+    assert_arg(image);
+    assert_arg(allocation);
+    *image = VK_NULL_HANDLE;
+    memset(allocation, 0, sizeof(*allocation));
+    try(vkCreateImage(memory->device, create_info, 0, image));
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(memory->device, *image, &requirements);
+    GpuMemoryResource resource = create_info->tiling == VK_IMAGE_TILING_OPTIMAL ?
+        GPU_MEMORY_RESOURCE_OPTIMAL : GPU_MEMORY_RESOURCE_LINEAR;
+    /* lazily allocated memory only stays unbacked if nothing else lives in it,
+     * and a block of it couldn't hold anything but transient attachments */
+    if(create_info->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) resource = GPU_MEMORY_RESOURCE_DEDICATED;
+    try(gpu_memory_alloc(memory, &requirements, required, preferred, resource, allocation));
+    try(vkBindImageMemory(memory->device, *image, allocation->memory, allocation->offset));
+    return 0;
+error:
+    gpu_memory_destroy_image(memory, *image, allocation);
+    *image = VK_NULL_HANDLE;
+    return -1;
+}
+
+void gpu_memory_destroy_image(GpuMemory *memory, VkImage image, GpuAllocation *allocation) {
+    assert_arg(memory);
+    assert_arg(allocation);
+    vkDestroyImage(memory->device, image, 0);
+    gpu_memory_free(memory, allocation);
+}
+
+void gpu_memory_stats(GpuMemory *memory, GpuMemoryStats *stats) {
+    assert_arg(memory);
+    assert_arg(stats);
+    memset(stats, 0, sizeof(*stats));
+    VkDeviceSize free_total = 0;
+    VkDeviceSize largest_total = 0;
+    for(size_t i = 0; i < array_len(memory->blocks); ++i) {
+        GpuMemoryBlock *block = array_at(memory->blocks, i);
+        VkDeviceSize largest = block_largest_free(block);
+        stats->reserved += block->size;
+        stats->used += block->used;
+        stats->allocations += block->allocations;
+        free_total += block->size - block->used;
+        largest_total += largest;
+        if(largest > stats->largest_free) stats->largest_free = largest;
+    }
+    stats->blocks = array_len(memory->blocks);
+    stats->dedicated = memory->dedicated;
+    stats->reserved += memory->dedicated_size;
+    stats->used += memory->dedicated_size;
+    stats->allocations += memory->dedicated;
+    stats->device_allocations = memory->device_allocations;
+    stats->requested = memory->requested;
+    stats->fragmentation = free_total ? 1.0 - (double)largest_total / (double)free_total : 0.0;
+}
+
+void gpu_linear_init(GpuLinear *linear, GpuAllocation allocation) {
+    assert_arg(linear);
+    linear->allocation = allocation;
+    linear->head = 0;
+}
+
+int gpu_linear_alloc(GpuLinear *linear, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *offset) {
+    assert_arg(linear);
+    assert_arg(offset);
+    VkDeviceSize aligned = alignment ? (linear->head + alignment - 1) / alignment * alignment : linear->head;
+    if(aligned + size > linear->allocation.size) return -1;
+    *offset = aligned;
+    linear->head = aligned + size;
+    return 0;
+}
+
+void gpu_linear_reset(GpuLinear *linear) {
+    assert_arg(linear);
+    linear->head = 0;
+}
+
@@ -0,0 +1,92 @@
+#ifndef GPU_MEMORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <vulkan/vulkan.h>
+#include "util.h"
+
+#define GPU_MEMORY_BLOCK_SIZE   ((VkDeviceSize)64 << 20)
+#define GPU_MEMORY_MIN_ORDER    8   // smallest buddy is 256 bytes
+#define GPU_MEMORY_MAX_ORDER    40
+
+/* buffers and linear images never share a block with optimal images,
+ * that way bufferImageGranularity can't be violated. if the granularity is
+ * no larger than the smallest buddy every allocation starts on a page of its
+ * own anyway, then both kinds share blocks */
+typedef enum {
+    GPU_MEMORY_RESOURCE_LINEAR,
+    GPU_MEMORY_RESOURCE_OPTIMAL,
+    GPU_MEMORY_RESOURCE_DEDICATED,  // a device allocation of its own, e.g. transient attachments
+    /* add above */
+    GPU_MEMORY_RESOURCE__COUNT,
+} GpuMemoryResource;
+
+typedef struct GpuMemoryBlock {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint32_t memory_type;
+    uint32_t max_order;
+    GpuMemoryResource resource;
+    void *mapped;                                   // persistently mapped if host visible
+    VkDeviceSize used;
+    size_t allocations;
+    VkDeviceSize *free[GPU_MEMORY_MAX_ORDER + 1];   // buddy free lists, offsets by order
+} GpuMemoryBlock;
+
+typedef struct GpuAllocation {
+    GpuMemoryBlock *block;  // 0 if dedicated
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    uint32_t order;
+    uint32_t memory_type;
+    void *mapped;           // 0 unless host visible
+} GpuAllocation;
+
+typedef struct GpuMemoryStats {
+    size_t blocks;
+    size_t dedicated;
+    size_t device_allocations;  // live vkAllocateMemory
+    size_t allocations;
+    VkDeviceSize reserved;      // bytes allocated from the device
+    VkDeviceSize used;          // bytes handed out, including buddy rounding
+    VkDeviceSize requested;     // bytes asked for
+    VkDeviceSize largest_free;
+    double fragmentation;       // 1 - sum of largest free range per block / free
+} GpuMemoryStats;
+
+typedef struct GpuMemory {
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties properties;
+    VkDeviceSize granularity;   // bufferImageGranularity
+    uint32_t max_allocations;
+    GpuMemoryBlock **blocks;
+    size_t device_allocations;
+    size_t dedicated;
+    VkDeviceSize dedicated_size;
+    VkDeviceSize requested;
+} GpuMemory;
+
+/* bump allocator inside one allocation, reset every frame, offsets relative to the allocation */
+typedef struct GpuLinear {
+    GpuAllocation allocation;
+    VkDeviceSize head;
+} GpuLinear;
+
+void gpu_memory_init(GpuMemory *memory, VkPhysicalDevice physical, VkDevice device);
+void gpu_memory_free_all(GpuMemory *memory);
+int gpu_memory_alloc(GpuMemory *memory, const VkMemoryRequirements *requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, GpuMemoryResource resource, GpuAllocation *allocation);
+void gpu_memory_free(GpuMemory *memory, GpuAllocation *allocation);
+int gpu_memory_create_buffer(GpuMemory *memory, const VkBufferCreateInfo *create_info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkBuffer *buffer, GpuAllocation *allocation);
+void gpu_memory_destroy_buffer(GpuMemory *memory, VkBuffer buffer, GpuAllocation *allocation);
+int gpu_memory_create_image(GpuMemory *memory, const VkImageCreateInfo *create_info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkImage *image, GpuAllocation *allocation);
+void gpu_memory_destroy_image(GpuMemory *memory, VkImage image, GpuAllocation *allocation);
+void gpu_memory_stats(GpuMemory *memory, GpuMemoryStats *stats);
+
+void gpu_linear_init(GpuLinear *linear, GpuAllocation allocation);
+int gpu_linear_alloc(GpuLinear *linear, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *offset);
+void gpu_linear_reset(GpuLinear *linear);
+
+#define GPU_MEMORY_H
+#endif
+
@@ -0,0 +1,107 @@
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ktx2.h"
+
+static const uint8_t ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+int ktx2_open(Ktx2 *ktx, const char *path) {
+    assert_arg(ktx);
+    assert_arg(path);
+    memset(ktx, 0, sizeof(*ktx));
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        println("could not open texture '%s'", path);
+        goto error;
+    }
+    struct stat st;
+    if(fstat(fd, &st) || (size_t)st.st_size < sizeof(Ktx2Header)) {
+        close(fd);
+        println("texture '%s' too small", path);
+        goto error;
+    }
+    void *map = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        println("could not map texture '%s'", path);
+        goto error;
+    }
+    ktx->map = map;
+    ktx->map_size = (size_t)st.st_size;
+    const Ktx2Header *header = map;
+    if(memcmp(header->identifier, ktx2_identifier, sizeof(ktx2_identifier))) {
+        println("'%s' is not a KTX2 file", path);
+        goto error;
+    }
+    /* basis universal and supercompressed levels would need a transcoder */
+    if(header->vk_format == VK_FORMAT_UNDEFINED || header->supercompression) {
+        println("'%s' is supercompressed, not supported", path);
+        goto error;
+    }
+    if(header->pixel_depth > 1 || header->layer_count > 1 || header->face_count != 1 || !header->pixel_width || !header->pixel_height) {
+        println("'%s' is not a 2D texture", path);
+        goto error;
+    }
+    if(!header->level_count) {
+        println("'%s' has no mip levels", path);
+        goto error;
+    }
+    if(header->level_count > KTX2_LEVELS_MAX) {
+        println("'%s' has %u mip levels, more than %u", path, header->level_count, KTX2_LEVELS_MAX);
+        goto error;
+    }
+    if(sizeof(*header) + (size_t)header->level_count * sizeof(Ktx2Level) > ktx->map_size) {
+        println("'%s' level index truncated", path);
+        goto error;
+    }
+    ktx->format = (VkFormat)header->vk_format;
+    ktx->extent = (VkExtent3D){ header->pixel_width, header->pixel_height, 1 };
+    ktx->levels = header->level_count;
+    ktx->level_index = (const Ktx2Level *)(header + 1);
+    for(uint32_t i = 0; i < ktx->levels; ++i) {
+        const Ktx2Level *level = &ktx->level_index[i];
+        if(level->offset > ktx->map_size || level->length > ktx->map_size - level->offset) {
+            println("'%s' level %u truncated", path, i);
+            goto error;
+        }
+    }
+    return 0;
+error:
+    ktx2_close(ktx);
+    return -1;
+}
+
+void ktx2_close(Ktx2 *ktx) {
+    assert_arg(ktx);
+    if(ktx->map) {
+        munmap(ktx->map, ktx->map_size);
+    }
+    memset(ktx, 0, sizeof(*ktx));
+}
+
+bool ktx2_is_open(Ktx2 *ktx) {
+    assert_arg(ktx);
+    return ktx->map != 0;
+}
+
+VkExtent3D ktx2_level_extent(Ktx2 *ktx, uint32_t level) {
+    assert_arg(ktx);
+    VkExtent3D extent = {
+        .width = ktx->extent.width >> level ? ktx->extent.width >> level : 1,
+        .height = ktx->extent.height >> level ? ktx->extent.height >> level : 1,
+        .depth = 1,
+    };
+    return extent;
+}
+
+/* points into the mapping, valid until ktx2_close */
+const void *ktx2_level_data(Ktx2 *ktx, uint32_t level, VkDeviceSize *size) {
+    assert_arg(ktx);
+    assert_arg(size);
+    if(level >= ktx->levels) return 0;
+    const Ktx2Level *entry = &ktx->level_index[level];
+    *size = entry->length;
+    return (const unsigned char *)ktx->map + entry->offset;
+}
@@ -0,0 +1,56 @@
+#ifndef KTX2_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "util.h"
+
+#define KTX2_LEVELS_MAX     16
+
+/* the file layout, little endian */
+typedef struct Ktx2Header {
+    uint8_t identifier[12];     // «KTX 20»\r\n\x1A\n
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t layer_count;
+    uint32_t face_count;
+    uint32_t level_count;       // 0: generate the mips, not supported
+    uint32_t supercompression;  // 0: none, the only scheme supported
+    uint32_t dfd_offset;
+    uint32_t dfd_length;
+    uint32_t kvd_offset;
+    uint32_t kvd_length;
+    uint64_t sgd_offset;
+    uint64_t sgd_length;
+} Ktx2Header;
+
+typedef struct Ktx2Level {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t uncompressed_length;
+} Ktx2Level;
+
+/* a mapped KTX2 container of a 2D texture, the levels are used in place and
+ * only paged in when read, so nothing is copied before it's uploaded */
+typedef struct Ktx2 {
+    void *map;
+    size_t map_size;
+    VkFormat format;
+    VkExtent3D extent;
+    uint32_t levels;
+    const Ktx2Level *level_index;   // level 0 is the largest
+} Ktx2;
+
+int ktx2_open(Ktx2 *ktx, const char *path);
+void ktx2_close(Ktx2 *ktx);
+bool ktx2_is_open(Ktx2 *ktx);
+VkExtent3D ktx2_level_extent(Ktx2 *ktx, uint32_t level);
+const void *ktx2_level_data(Ktx2 *ktx, uint32_t level, VkDeviceSize *size);
+
+#define KTX2_H
+#endif
+
@@ -1,25 +1,78 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <rlc/array.h>
 #include "log.h"
 
+static int log_tid(Log *log);
+
 void log_output(Log *log, bool enable) {
     log->enable_output = enable;
 }
 
 void log_start(Log *log) {
-    clock_gettime(CLOCK_REALTIME, &log->t0);
+    /* the log macros hold it while the spans take it again */
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&log->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    clock_gettime(CLOCK_MONOTONIC, &log->t0);
     log->level = -2;
     log_output(log, true);
 }
 
+void log_lock(Log *log) {
+    assert_arg(log);
+    pthread_mutex_lock(&log->mutex);
+}
+
+void log_unlock(Log *log) {
+    assert_arg(log);
+    pthread_mutex_unlock(&log->mutex);
+}
+
+/* the calling thread's state, created at log->level. hold the mutex */
+static LogThread *log_thread_state(Log *log) {
+    assert_arg(log);
+    int tid = log_tid(log);
+    while(array_len(log->thread_state) < (size_t)tid) {
+        LogThread state = { .level = log->level };
+        array_push(log->thread_state, state);
+    }
+    return array_it(log->thread_state, tid - 1);
+}
+
+/* threads logging for the first time from now on nest at the calling thread's level */
+void log_inherit(Log *log) {
+    assert_arg(log);
+    log_lock(log);
+    log->level = log_thread_state(log)->level;
+    log_unlock(log);
+}
+
+int log_level(Log *log) {
+    assert_arg(log);
+    log_lock(log);
+    int level = log_thread_state(log)->level;
+    log_unlock(log);
+    return level;
+}
+
 void log_t_update(Log *log) {
     assert_arg(log);
-    clock_gettime(CLOCK_REALTIME, &log->tE);
+    log_lock(log);
+    clock_gettime(CLOCK_MONOTONIC, &log_thread_state(log)->tE);
+    log_unlock(log);
 }
 
 void log_up(Log *log) {
     assert_arg(log);
-    if(!log->enable_output) return;
+    log_lock(log);
     log_t_update(log);
-    log->level -= 2;
+    log_span_end(log);
+    log_thread_state(log)->level -= 2;
+    log_unlock(log);
 }
 
 void _log_ok(Log *log) {
@@ -27,15 +80,30 @@ void _log_ok(Log *log) {
     log_t_update(log);
 }
 
-void _log_down(Log *log) {
+void _log_down(Log *log, const char *msg, ...) {
     assert_arg(log);
     log_t_update(log);
-    log->level += 2;
+    log_thread_state(log)->level += 2;
+    if(!log->trace) return;
+    char name[LOG_SPAN_NAME];
+    va_list args;
+    va_start(args, msg);
+    vsnprintf(name, sizeof(name), msg, args);
+    va_end(args);
+    log_span_begin(log, name);
 }
 
-void _log_info(Log *log) {
+void _log_info(Log *log, const char *msg, ...) {
     assert_arg(log);
     log_t_update(log);
+    if(!log->trace) return;
+    char name[LOG_SPAN_NAME];
+    va_list args;
+    va_start(args, msg);
+    vsnprintf(name, sizeof(name), msg, args);
+    va_end(args);
+    double now = log_now();
+    log_span_add(log, name, now, now);
 }
 
 struct timespec diff_timespec(const struct timespec *time1,
@@ -53,8 +121,130 @@ struct timespec diff_timespec(const struct timespec *time1,
 
 double log_t_sec(Log *log) {
     assert_arg(log);
-    struct timespec delta = diff_timespec(&log->tE, &log->t0);
+    log_lock(log);
+    struct timespec delta = diff_timespec(&log_thread_state(log)->tE, &log->t0);
+    log_unlock(log);
     return (double)delta.tv_sec + (double)delta.tv_nsec / 1e9;
 }
 
+double log_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static double log_since_start(Log *log, double t) {
+    assert_arg(log);
+    return t - ((double)log->t0.tv_sec + (double)log->t0.tv_nsec / 1e9);
+}
+
+/* small per thread id, the lane in the trace viewer */
+static _Thread_local int log_thread;
+
+static int log_tid(Log *log) {
+    assert_arg(log);
+    if(!log_thread) log_thread = ++log->threads;
+    return log_thread;
+}
+
+static int log_depth(Log *log, int tid) {
+    assert_arg(log);
+    int depth = 0;
+    for(size_t i = 0; i < array_len(log->open); ++i) {
+        if(array_it(log->spans, array_at(log->open, i))->tid == tid) ++depth;
+    }
+    return depth;
+}
+
+static void log_span_push(Log *log, const char *name, double begin, double end, bool open) {
+    assert_arg(log);
+    assert_arg(name);
+    pthread_mutex_lock(&log->mutex);
+    int tid = log_tid(log);
+    LogSpan span = {
+        .begin = log_since_start(log, begin),
+        .end = open ? -1.0 : log_since_start(log, end),
+        .depth = log_depth(log, tid),
+        .tid = tid,
+    };
+    snprintf(span.name, sizeof(span.name), "%s", name);
+    if(open) array_push(log->open, array_len(log->spans));
+    array_push(log->spans, span);
+    pthread_mutex_unlock(&log->mutex);
+}
+
+void log_span_begin(Log *log, const char *name) {
+    assert_arg(log);
+    if(!log->trace) return;
+    log_span_push(log, name, log_now(), 0, true);
+}
 
+void log_span_end(Log *log) {
+    assert_arg(log);
+    if(!log->trace) return;
+    double now = log_now();
+    pthread_mutex_lock(&log->mutex);
+    int tid = log_tid(log);
+    /* innermost span opened by this thread */
+    for(size_t i = array_len(log->open); i > 0; --i) {
+        size_t index = array_at(log->open, i - 1);
+        LogSpan *span = array_it(log->spans, index);
+        if(span->tid != tid) continue;
+        span->end = log_since_start(log, now);
+        for(size_t j = i; j < array_len(log->open); ++j) {
+            *array_it(log->open, j - 1) = array_at(log->open, j);
+        }
+        array_resize(log->open, array_len(log->open) - 1);
+        break;
+    }
+    pthread_mutex_unlock(&log->mutex);
+}
+
+void log_span_add(Log *log, const char *name, double begin, double end) {
+    assert_arg(log);
+    if(!log->trace) return;
+    log_span_push(log, name, begin, end, false);
+}
+
+static void log_json_string(FILE *file, const char *str) {
+    fputc('"', file);
+    for(; *str; ++str) {
+        if(*str == '"' || *str == '\\') fputc('\\', file);
+        if((unsigned char)*str < 0x20) continue;
+        fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+/* chrome trace event format, opens in chrome://tracing and ui.perfetto.dev */
+int log_trace_write_json(Log *log, const char *path) {
+    assert_arg(log);
+    assert_arg(path);
+    FILE *file = fopen(path, "w");
+    if(!file) return -1;
+    double now = log_since_start(log, log_now());
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for(size_t i = 0; i < array_len(log->spans); ++i) {
+        LogSpan *span = array_it(log->spans, i);
+        fprintf(file, "%s\n{\"name\":", i ? "," : "");
+        log_json_string(file, span->name);
+        if(span->end == span->begin) {
+            fprintf(file, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", span->begin * 1e6, span->tid);
+        } else {
+            /* still open, e.g. written from inside a span */
+            double end = span->end < 0 ? now : span->end;
+            fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"depth\":%d}}",
+                    span->begin * 1e6, (end - span->begin) * 1e6, span->tid, span->depth);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) ? -1 : 0;
+}
+
+void log_free(Log *log) {
+    assert_arg(log);
+    array_free(log->spans);
+    array_free(log->open);
+    array_free(log->thread_state);
+    pthread_mutex_destroy(&log->mutex);
+}
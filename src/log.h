@@ -1,44 +1,82 @@
 #ifndef LOG_H
 
+#include <pthread.h>
 #include <time.h>
 #include <stdbool.h>
 #include "util.h"
 
-typedef struct Log {
+#define LOG_SPAN_NAME   64
+
+/* log_down/log_up pairs and frame phases, kept when tracing */
+typedef struct LogSpan {
+    char name[LOG_SPAN_NAME];
+    double begin;   // seconds since log_start
+    double end;     // negative while open, equal to begin for instant events
+    int depth;
+    int tid;
+} LogSpan;
+
+/* nesting and the time of the last update, per thread: startup steps running
+ * in parallel would otherwise nest under each other and time each other */
+typedef struct LogThread {
     int level;
-    struct timespec t0;
     struct timespec tE;
+} LogThread;
+
+typedef struct Log {
+    int level;              // where a thread starts nesting on its first log call, see log_inherit
+    struct timespec t0;
+    LogThread *thread_state;    // by span thread id - 1
     bool enable_output;
+    bool trace;             // record spans for log_trace_write_json
+    LogSpan *spans;
+    size_t *open;           // open span indices, innermost last per thread
+    int threads;            // threads that logged, ids of thread_state and the spans
+    pthread_mutex_t mutex;  // recursive, startup worker threads log too: level, tE, spans and the output
 } Log;
 
 #define LOG_PRINT(ch, log, msg, ...)    \
-    println("%*s" ch " " msg F(" %.4fs", IT FG_BK_B), (log)->level, "", ##__VA_ARGS__, log_t_sec(log)); \
+    println("%*s" ch " " msg F(" %.4fs", IT FG_BK_B), log_level(log), "", ##__VA_ARGS__, log_t_sec(log)); \
 
 #define log_down(log, msg, ...)   do { \
-        if(!(log)->enable_output) break; \
-        _log_down(log); \
-        LOG_PRINT(F(">", FG_BL_B), log, msg, ##__VA_ARGS__); \
+        log_lock(log); \
+        _log_down(log, msg, ##__VA_ARGS__); \
+        if((log)->enable_output) LOG_PRINT(F(">", FG_BL_B), log, msg, ##__VA_ARGS__); \
+        log_unlock(log); \
     } while(0)
 
 void log_output(Log *log, bool enable);
 void log_start(Log *log);
+void log_lock(Log *log);
+void log_unlock(Log *log);
+void log_inherit(Log *log);
+int log_level(Log *log);
 void log_up(Log *log);
 void _log_ok(Log *log);
-void _log_down(Log *log);
-void _log_info(Log *log);
+void _log_down(Log *log, const char *msg, ...) __attribute__((format(printf, 2, 3)));
+void _log_info(Log *log, const char *msg, ...) __attribute__((format(printf, 2, 3)));
 
 double log_t_sec(Log *log);
+double log_now(void);
+void log_span_begin(Log *log, const char *name);
+void log_span_end(Log *log);
+void log_span_add(Log *log, const char *name, double begin, double end);
+int log_trace_write_json(Log *log, const char *path);
+void log_free(Log *log);
 
 #define log_info(log, msg, ...)    do { \
-        if(!(log)->enable_output) break; \
-        _log_info(log); \
-        LOG_PRINT(F("-", FG_BL_B), log, msg, ##__VA_ARGS__); \
+        log_lock(log); \
+        _log_info(log, msg, ##__VA_ARGS__); \
+        if((log)->enable_output) LOG_PRINT(F("-", FG_BL_B), log, msg, ##__VA_ARGS__); \
+        log_unlock(log); \
     } while(0)
 
 #define log_ok(log, msg, ...)       do { \
         if(!(log)->enable_output) break; \
+        log_lock(log); \
         _log_ok(log); \
         LOG_PRINT(F("*", FG_GN_B BOLD), log, msg, ##__VA_ARGS__); \
+        log_unlock(log); \
     } while(0)
 
 
@@ -1,26 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include <rlc/array.h>
 #include "app.h"
 #include "util.h"
 
-int main() {
+int main(int argc, char **argv) {
 
     int err = 0;
     App app = {
         .name = "c-vulkan",
         .engine = "c-vulkan",
+        .variants.threads = PIPELINE_VARIANTS_THREADS,
     };
 #if !defined(NDEBUG)
     app.validation.enable = true;
 #endif
+    size_t bench_frames = 0;
+    size_t bench_resize = 0;
+    const char *stats_json = 0;
+    const char *stats_csv = 0;
+    const char *trace_json = 0;
+    for(int i = 1; i < argc; ++i) {
+        if(!strcmp(argv[i], "--headless")) {
+            app.display = APP_DISPLAY_OFFSCREEN;
+        } else if(!strcmp(argv[i], "--headless-surface")) {
+            app.display = APP_DISPLAY_HEADLESS_SURFACE;
+        } else if(!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            bench_frames = strtoull(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--bench-resize") && i + 1 < argc) {
+            bench_resize = strtoull(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--stats-json") && i + 1 < argc) {
+            stats_json = argv[++i];
+        } else if(!strcmp(argv[i], "--stats-csv") && i + 1 < argc) {
+            stats_csv = argv[++i];
+        } else if(!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            trace_json = argv[++i];
+            app.log.trace = true;
+        } else if(!strcmp(argv[i], "--cached-commands")) {
+            app.cached_commands.enable = true;
+        } else if(!strcmp(argv[i], "--pipeline-cache") && i + 1 < argc) {
+            app.pipeline_cache.path = argv[++i];
+        } else if(!strcmp(argv[i], "--instances") && i + 1 < argc) {
+            app.geometry.instance_count = strtoul(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--draws") && i + 1 < argc) {
+            app.geometry.draws = strtoul(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--device") && i + 1 < argc) {
+            app.physical.override = argv[++i];
+        } else if(!strcmp(argv[i], "--device-cache") && i + 1 < argc) {
+            app.physical.cache.path = argv[++i];
+        } else if(!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            app.recorder.threads = strtoull(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--serial-startup")) {
+            app.serial_startup = true;
+        } else if(!strcmp(argv[i], "--pacing") && i + 1 < argc) {
+            if(pacing_mode_parse(argv[++i], &app.pacing.mode)) {
+                println("unknown pacing: %s", argv[i]);
+                return -1;
+            }
+        } else if(!strcmp(argv[i], "--fps") && i + 1 < argc) {
+            app.pacing.fps = strtod(argv[++i], 0);
+        } else if(!strcmp(argv[i], "--variant") && i + 1 < argc) {
+            app.variant_name = argv[++i];
+        } else if(!strcmp(argv[i], "--pipeline-threads") && i + 1 < argc) {
+            app.variants.threads = strtoull(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--shader-archive") && i + 1 < argc) {
+#ifdef SHADERS_ARCHIVE
+            app.shaders.path = argv[++i];
+#else
+            println("--shader-archive needs a build with -Dshaders=archive, the shaders are embedded");
+            return -1;
+#endif
+        } else if(!strcmp(argv[i], "--particles") && i + 1 < argc) {
+            app.particles.count = strtoul(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--msaa") && i + 1 < argc) {
+            app.msaa.requested = strtoul(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--overdraw") && i + 1 < argc) {
+            app.geometry.layers = strtoul(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--order") && i + 1 < argc) {
+            if(geometry_order_parse(argv[++i], &app.geometry.order)) {
+                println("unknown order: %s", argv[i]);
+                return -1;
+            }
+        } else if(!strcmp(argv[i], "--materials") && i + 1 < argc) {
+            app.materials.count = strtoul(argv[++i], 0, 0);
+        } else if(!strcmp(argv[i], "--gpu-cull")) {
+            app.culling.enable = true;
+        } else if(!strcmp(argv[i], "--spread") && i + 1 < argc) {
+            app.geometry.spread = strtof(argv[++i], 0);
+        } else if(!strcmp(argv[i], "--zoom") && i + 1 < argc) {
+            app.camera.zoom = strtof(argv[++i], 0);
+        } else if(!strcmp(argv[i], "--texture") && i + 1 < argc) {
+            array_push(app.texture_paths, argv[++i]);
+        } else if(!strcmp(argv[i], "--render-pass")) {
+            app.force_render_pass = true;
+        } else if(!strcmp(argv[i], "--frames-in-flight") && i + 1 < argc) {
+            app.frames_in_flight = strtoull(argv[++i], 0, 0);
+            if(app.frames_in_flight < 1 || app.frames_in_flight > APP_MAX_FRAMES_IN_FLIGHT) {
+                println("frames in flight must be 1 to %d", APP_MAX_FRAMES_IN_FLIGHT);
+                return -1;
+            }
+        } else {
+            println("unknown argument: %s", argv[i]);
+            return -1;
+        }
+    }
+
+    if(app.particles.count && app.cached_commands.enable) {
+        println("--particles draws a different buffer every frame, not combined with --cached-commands");
+        return -1;
+    }
+    if(app.pacing.fps > 0 && app.pacing.mode == PACING_UNCAPPED) {
+        println("--fps caps the frame rate, not combined with --pacing uncapped");
+        return -1;
+    }
+    if(app.recorder.threads && app.cached_commands.enable) {
+        println("--threads records every frame, not combined with --cached-commands");
+        return -1;
+    }
+    if(app.culling.enable && (app.cached_commands.enable || app.recorder.threads)) {
+        println("--gpu-cull records two commands for all objects, not combined with --cached-commands or --threads");
+        return -1;
+    }
+    if(app.culling.enable && app.materials.count) {
+        println("--gpu-cull draws every object with the default material, not combined with --materials");
+        return -1;
+    }
+
+    /* keep every frame of a benchmark run for the percentiles */
+    if(bench_frames > FRAME_STATS_CAPACITY) app.stats.capacity = bench_frames;
 
     try(app_init(&app));
 #if 1
-    double t0 = glfwGetTime();
+    double t0 = frame_stats_now();
     size_t frames = 0;
-    while(!glfwWindowShouldClose(app.window)) {
-        glfwPollEvents();
+    while(!app_should_close(&app)) {
+        if(bench_frames && app.stats.frames - app.stats.skipped >= bench_frames) break;
+        if(bench_resize) {
+            /* resize storm: a new size every frame, or forced recreation without a window */
+            --bench_resize;
+            if(app.window) {
+                glfwSetWindowSize(app.window, APP_WIDTH + (bench_resize % 8) * 16, APP_HEIGHT + (bench_resize % 5) * 16);
+            } else {
+                app.swap_chain_recreate = true;
+            }
+        }
+        app_poll_events(&app);
         try(app_render(&app));
         ++frames;
-        double tX = glfwGetTime();
+        double tX = frame_stats_now();
         if(tX - t0 > 2.0) {
             printf("%9.1f fps\n", (double)frames/(tX-t0));
             frames = 0;
@@ -28,9 +155,27 @@ int main() {
         }
     }
 #endif
+    frame_stats_print(&app.stats);
+    printf("rendering: %s\n", app.features.dynamic_rendering ? "dynamic rendering" : "render pass");
+    if(app.geometry.layers) {
+        if(app.features.pipeline_statistics) {
+            printf("overdraw: %u layers, order %s, %.2f fragments per pixel\n", app.geometry.layers,
+                    geometry_order_str(app.geometry.order), app_fragments_per_pixel(&app));
+        } else {
+            printf("overdraw: pipeline statistics not supported\n");
+        }
+    }
+    if(stats_json) try(frame_stats_write_json(&app.stats, stats_json));
+    if(stats_csv) try(frame_stats_write_csv(&app.stats, stats_csv));
 
 clean:
     app_free(&app);
+    /* after app_free, so teardown is part of the trace */
+    if(trace_json && log_trace_write_json(&app.log, trace_json)) {
+        println("failed to write trace '%s'", trace_json);
+        err = -1;
+    }
+    log_free(&app.log);
     return err;
 error:
     err = -1;
@@ -0,0 +1,148 @@
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <rlc/array.h>
+#include "pacing.h"
+
+static const char *pacing_mode_names[PACING__COUNT] = {
+    [PACING_DEFAULT] = "default",
+    [PACING_LATENCY] = "latency",
+    [PACING_SMOOTH] = "smooth",
+    [PACING_RELAXED] = "relaxed",
+    [PACING_UNCAPPED] = "uncapped",
+};
+
+#define PACING_PRESENT_END  VK_PRESENT_MODE_MAX_ENUM_KHR
+
+/* first available wins, fifo is always supported. every row ends in
+ * PACING_PRESENT_END, zero padding would be VK_PRESENT_MODE_IMMEDIATE_KHR */
+static const VkPresentModeKHR pacing_present_modes[PACING__COUNT][4] = {
+    [PACING_DEFAULT] = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, PACING_PRESENT_END },
+    [PACING_LATENCY] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, PACING_PRESENT_END },
+    [PACING_SMOOTH] = { VK_PRESENT_MODE_FIFO_KHR, PACING_PRESENT_END },
+    [PACING_RELAXED] = { VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR, PACING_PRESENT_END },
+    [PACING_UNCAPPED] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, PACING_PRESENT_END },
+};
+
+const char *pacing_mode_str(PacingMode mode) {
+    assert(mode < PACING__COUNT);
+    return pacing_mode_names[mode];
+}
+
+int pacing_mode_parse(const char *str, PacingMode *mode) {
+    assert_arg(str);
+    assert_arg(mode);
+    for(size_t i = 0; i < PACING__COUNT; ++i) {
+        if(strcasecmp(str, pacing_mode_names[i])) continue;
+        *mode = (PacingMode)i;
+        return 0;
+    }
+    return -1;
+}
+
+const char *pacing_present_mode_str(VkPresentModeKHR present_mode) {
+    switch(present_mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo relaxed";
+        default: return "other";
+    }
+}
+
+VkPresentModeKHR pacing_present_mode(Pacing *pacing, VkPresentModeKHR *available) {
+    assert_arg(pacing);
+    const VkPresentModeKHR *wanted = pacing_present_modes[pacing->mode];
+    for(size_t i = 0; wanted[i] != PACING_PRESENT_END; ++i) {
+        if(wanted[i] == VK_PRESENT_MODE_FIFO_KHR) break;
+        for(size_t j = 0; j < array_len(available); ++j) {
+            if(array_at(available, j) == wanted[i]) return wanted[i];
+        }
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+uint32_t pacing_image_count(Pacing *pacing, VkSurfaceCapabilitiesKHR *capabilities) {
+    assert_arg(pacing);
+    assert_arg(capabilities);
+    uint32_t image_count = capabilities->minImageCount;
+    switch(pacing->mode) {
+        /* every queued image is a frame of latency */
+        case PACING_LATENCY: break;
+        case PACING_SMOOTH: image_count += 2; break;
+        default: image_count += 1; break;
+    }
+    if(capabilities->maxImageCount > 0 && image_count > capabilities->maxImageCount) {
+        image_count = capabilities->maxImageCount;
+    }
+    return image_count;
+}
+
+/* sleep until the frame deadline, then spin the remainder for precision */
+void pacing_limit(Pacing *pacing) {
+    assert_arg(pacing);
+    if(pacing->fps <= 0 || pacing->mode == PACING_UNCAPPED) return;
+    double period = 1.0 / pacing->fps;
+    double now = frame_stats_now();
+    if(!pacing->next || now - pacing->next > period) {
+        /* first frame, or more than a frame late: don't rush to catch up */
+        pacing->next = now;
+    }
+    double sleep = pacing->next - now - PACING_SPIN_SEC;
+    if(sleep > 0) {
+        struct timespec t = {
+            .tv_sec = (time_t)sleep,
+            .tv_nsec = (long)((sleep - (double)(time_t)sleep) * 1e9),
+        };
+        nanosleep(&t, 0);
+    }
+    while(frame_stats_now() < pacing->next) {}
+    pacing->next += period;
+}
+
+uint64_t pacing_present_id(Pacing *pacing, size_t frame) {
+    assert_arg(pacing);
+    if(!pacing->present.enable) return 0;
+    uint64_t id = ++pacing->present.id;
+    pacing->present.ring[id % PACING_PRESENT_RING] = (PacingPresent){
+        .id = id,
+        .frame = frame,
+        .t_present = frame_stats_now(),
+    };
+    return id;
+}
+
+/* record when presents reached the screen, in latency mode wait for it. the
+ * other modes only poll once per frame, so a present is seen on screen up to
+ * a frame after it got there and the time is an upper bound */
+void pacing_present_poll(Pacing *pacing, VkDevice device, VkSwapchainKHR swap_chain, FrameStats *stats) {
+    assert_arg(pacing);
+    assert_arg(stats);
+    if(!pacing->present.enable || !swap_chain) return;
+    uint64_t timeout = pacing->mode == PACING_LATENCY ? PACING_WAIT_NS : 0;
+    while(pacing->present.done < pacing->present.id) {
+        uint64_t id = pacing->present.done + 1;
+        PacingPresent *present = &pacing->present.ring[id % PACING_PRESENT_RING];
+        if(present->id != id) {
+            /* overwritten, nobody polled for too long */
+            pacing->present.done = id;
+            continue;
+        }
+        VkResult result = pacing->present.wait(device, swap_chain, id, timeout);
+        if(result == VK_TIMEOUT) break;
+        if(result != VK_SUCCESS) {
+            /* out of date or lost, the remaining ids will never complete */
+            pacing_present_reset(pacing);
+            break;
+        }
+        frame_stats_set(stats, present->frame, FRAME_STAT_DISPLAY_BY, (frame_stats_now() - present->t_present) * 1e3);
+        pacing->present.done = id;
+    }
+}
+
+/* ids of a retired swap chain are not waited on */
+void pacing_present_reset(Pacing *pacing) {
+    assert_arg(pacing);
+    pacing->present.done = pacing->present.id;
+}
+
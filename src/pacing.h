@@ -0,0 +1,56 @@
+#ifndef PACING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "frame_stats.h"
+#include "util.h"
+
+#define PACING_PRESENT_RING     16      // presents awaiting their on screen time
+#define PACING_SPIN_SEC         0.002   // busy wait the last bit, sleeps overshoot
+#define PACING_WAIT_NS          100000000   // longest wait for the previous present
+
+typedef enum {
+    PACING_DEFAULT,     // mailbox, else fifo, min + 1 images
+    PACING_LATENCY,     // immediate, fewest images, waits for the previous present
+    PACING_SMOOTH,      // fifo, min + 2 images to absorb spikes
+    PACING_RELAXED,     // fifo relaxed, tears only when a frame is late
+    PACING_UNCAPPED,    // immediate, no frame limiter, for benchmarks
+    /* add above */
+    PACING__COUNT,
+} PacingMode;
+
+typedef struct PacingPresent {
+    uint64_t id;
+    size_t frame;           // frame stats index
+    double t_present;       // just before vkQueuePresentKHR
+} PacingPresent;
+
+/* swap chain present mode and image count, cpu frame limiter and present timing */
+typedef struct Pacing {
+    PacingMode mode;
+    double fps;             // frame limiter target, 0 is off
+    double next;            // deadline of the next frame
+    struct {
+        bool enable;        // VK_KHR_present_id + VK_KHR_present_wait
+        PFN_vkWaitForPresentKHR wait;
+        uint64_t id;        // last id handed to a present
+        uint64_t done;      // last id known to be on screen
+        PacingPresent ring[PACING_PRESENT_RING];
+    } present;
+} Pacing;
+
+const char *pacing_mode_str(PacingMode mode);
+int pacing_mode_parse(const char *str, PacingMode *mode);
+const char *pacing_present_mode_str(VkPresentModeKHR present_mode);
+VkPresentModeKHR pacing_present_mode(Pacing *pacing, VkPresentModeKHR *available);
+uint32_t pacing_image_count(Pacing *pacing, VkSurfaceCapabilitiesKHR *capabilities);
+void pacing_limit(Pacing *pacing);
+uint64_t pacing_present_id(Pacing *pacing, size_t frame);
+void pacing_present_poll(Pacing *pacing, VkDevice device, VkSwapchainKHR swap_chain, FrameStats *stats);
+void pacing_present_reset(Pacing *pacing);
+
+#define PACING_H
+#endif
+
@@ -0,0 +1,331 @@
+#include <string.h>
+#include <rlc/array.h>
+#include "geometry.h"
+#include "particles.h"
+
+static int particles_create_buffers(Particles *particles) {
+    assert_arg(particles);
+    uint32_t families[] = {
+        particles->compute_family,
+        particles->graphics_family,
+    };
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = (VkDeviceSize)particles->count * sizeof(InstanceData),
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    if(particles_async(particles)) {
+        buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buffer_info.queueFamilyIndexCount = sizearray(families);
+        buffer_info.pQueueFamilyIndices = families;
+    }
+    for(size_t i = 0; i < sizearray(particles->state); ++i) {
+        try(gpu_memory_create_buffer(particles->gpu_memory, &buffer_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                    &particles->state[i], &particles->state_allocations[i]));
+    }
+    VkBufferCreateInfo velocity_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = (VkDeviceSize)particles->count * sizeof(float) * 2,
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    try(gpu_memory_create_buffer(particles->gpu_memory, &velocity_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                &particles->velocity, &particles->velocity_allocation));
+    return 0;
+error:
+    return -1;
+}
+
+static int particles_create_descriptors(Particles *particles) {
+    assert_arg(particles);
+    VkDescriptorSetLayoutBinding bindings[3];
+    for(size_t i = 0; i < sizearray(bindings); ++i) {
+        bindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = (uint32_t)i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        };
+    }
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = sizearray(bindings),
+        .pBindings = bindings,
+    };
+    try(vkCreateDescriptorSetLayout(particles->device, &layout_info, 0, &particles->set_layout));
+    VkDescriptorPoolSize pool_size = {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = sizearray(bindings) * sizearray(particles->sets),
+    };
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = sizearray(particles->sets),
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size,
+    };
+    try(vkCreateDescriptorPool(particles->device, &pool_info, 0, &particles->descriptor_pool));
+    VkDescriptorSetLayout layouts[] = {
+        particles->set_layout,
+        particles->set_layout,
+    };
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = particles->descriptor_pool,
+        .descriptorSetCount = sizearray(layouts),
+        .pSetLayouts = layouts,
+    };
+    try(vkAllocateDescriptorSets(particles->device, &alloc_info, particles->sets));
+    for(size_t i = 0; i < sizearray(particles->sets); ++i) {
+        /* set i reads state i and writes the other one */
+        VkDescriptorBufferInfo buffer_infos[] = {
+            { .buffer = particles->state[i], .range = VK_WHOLE_SIZE },
+            { .buffer = particles->state[(i + 1) % 2], .range = VK_WHOLE_SIZE },
+            { .buffer = particles->velocity, .range = VK_WHOLE_SIZE },
+        };
+        VkWriteDescriptorSet writes[sizearray(buffer_infos)];
+        for(size_t j = 0; j < sizearray(writes); ++j) {
+            writes[j] = (VkWriteDescriptorSet){
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = particles->sets[i],
+                .dstBinding = (uint32_t)j,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &buffer_infos[j],
+            };
+        }
+        vkUpdateDescriptorSets(particles->device, sizearray(writes), writes, 0, 0);
+    }
+    return 0;
+error:
+    return -1;
+}
+
+static int particles_create_pipeline(Particles *particles, ShaderRegistry *shaders, PipelineCache *cache) {
+    assert_arg(particles);
+    assert_arg(shaders);
+    assert_arg(cache);
+    try(shader_registry_create_module(shaders, particles->device, "particles.comp", &particles->module));
+    VkPushConstantRange push_range = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .size = sizeof(ParticlesPush),
+    };
+    VkPipelineLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &particles->set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_range,
+    };
+    try(vkCreatePipelineLayout(particles->device, &layout_info, 0, &particles->layout));
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = particles->module,
+            .pName = "main",
+        },
+        .layout = particles->layout,
+        .basePipelineIndex = -1,
+    };
+    try(vkCreateComputePipelines(particles->device, cache->cache, 1, &pipeline_info, 0, &particles->pipeline));
+    return 0;
+error:
+    return -1;
+}
+
+int particles_init(Particles *particles, VkDevice device, GpuMemory *gpu_memory, ShaderRegistry *shaders, PipelineCache *cache, VkQueue queue, uint32_t compute_family, uint32_t graphics_family, size_t frames_in_flight, bool timestamps) {
+    assert_arg(particles);
+    assert_arg(gpu_memory);
+    if(particles->count > PARTICLES_MAX) {
+        println("%u particles exceed the maximum of %u", particles->count, PARTICLES_MAX);
+        goto error;
+    }
+    particles->device = device;
+    particles->gpu_memory = gpu_memory;
+    particles->queue = queue;
+    particles->compute_family = compute_family;
+    particles->graphics_family = graphics_family;
+    try(particles_create_buffers(particles));
+    try(particles_create_descriptors(particles));
+    try(particles_create_pipeline(particles, shaders, cache));
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = compute_family,
+    };
+    try(vkCreateCommandPool(device, &pool_info, 0, &particles->pool));
+    VkQueryPoolCreateInfo query_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2,
+    };
+    array_resize(particles->slots, frames_in_flight);
+    memset(particles->slots, 0, sizeof(*particles->slots) * frames_in_flight);
+    for(size_t i = 0; i < frames_in_flight; ++i) {
+        ParticlesSlot *slot = array_it(particles->slots, i);
+        VkCommandBufferAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = particles->pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        try(vkAllocateCommandBuffers(device, &alloc_info, &slot->command_buffer));
+        if(timestamps) {
+            try(vkCreateQueryPool(device, &query_info, 0, &slot->query_pool));
+        }
+    }
+    VkSemaphoreTypeCreateInfoKHR type_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+        .initialValue = 0,
+    };
+    VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+    };
+    try(vkCreateSemaphore(device, &semaphore_info, 0, &particles->timeline));
+    return 0;
+error:
+    return -1;
+}
+
+void particles_free(Particles *particles) {
+    assert_arg(particles);
+    VkDevice device = particles->device;
+    for(size_t i = 0; i < array_len(particles->slots); ++i) {
+        ParticlesSlot *slot = array_it(particles->slots, i);
+        if(slot->query_pool) vkDestroyQueryPool(device, slot->query_pool, 0);
+    }
+    array_free(particles->slots);
+    vkDestroyCommandPool(device, particles->pool, 0);
+    vkDestroySemaphore(device, particles->timeline, 0);
+    vkDestroyPipeline(device, particles->pipeline, 0);
+    vkDestroyPipelineLayout(device, particles->layout, 0);
+    vkDestroyShaderModule(device, particles->module, 0);
+    vkDestroyDescriptorPool(device, particles->descriptor_pool, 0);
+    vkDestroyDescriptorSetLayout(device, particles->set_layout, 0);
+    if(particles->gpu_memory) {
+        for(size_t i = 0; i < sizearray(particles->state); ++i) {
+            gpu_memory_destroy_buffer(particles->gpu_memory, particles->state[i], &particles->state_allocations[i]);
+        }
+        gpu_memory_destroy_buffer(particles->gpu_memory, particles->velocity, &particles->velocity_allocation);
+    }
+    uint32_t count = particles->count;
+    memset(particles, 0, sizeof(*particles));
+    particles->count = count;
+}
+
+bool particles_async(Particles *particles) {
+    assert_arg(particles);
+    return particles->compute_family != particles->graphics_family;
+}
+
+/* what frame `step` draws */
+VkBuffer particles_buffer(Particles *particles, uint64_t step) {
+    assert_arg(particles);
+    return particles->state[(step + 1) % 2];
+}
+
+/* step N, submitted while recording frame N. frame_timeline: frame N signals N + 1 once completed */
+int particles_step(Particles *particles, size_t frame, VkSemaphore frame_timeline) {
+    assert_arg(particles);
+    uint64_t step = particles->steps;
+    ParticlesSlot *slot = array_it(particles->slots, step % array_len(particles->slots));
+    VkCommandBuffer command_buffer = slot->command_buffer;
+    /* the caller waited for frame N - frames in flight, which waited for this slot's last step */
+    try(vkResetCommandBuffer(command_buffer, 0));
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    try(vkBeginCommandBuffer(command_buffer, &begin_info));
+    if(slot->query_pool) {
+        vkCmdResetQueryPool(command_buffer, slot->query_pool, 0, 2);
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot->query_pool, 0);
+    }
+    ParticlesPush push = {
+        .dt = PARTICLES_DT,
+        .count = particles->count,
+        .reset = step == 0,
+        .scale = PARTICLES_SCALE,
+    };
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, particles->pipeline);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, particles->layout, 0, 1, &particles->sets[step % 2], 0, 0);
+    vkCmdPushConstants(command_buffer, particles->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(command_buffer, (particles->count + PARTICLES_LOCAL_SIZE - 1) / PARTICLES_LOCAL_SIZE, 1, 1);
+    /* the next step reads what this one wrote. the graphics queue gets it
+     * through the semaphore, its vertex input stage doesn't exist on a
+     * compute only queue */
+    VkBufferMemoryBarrier barriers[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = particles_buffer(particles, step),
+            .size = VK_WHOLE_SIZE,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = particles->velocity,
+            .size = VK_WHOLE_SIZE,
+        },
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            0, 0, sizearray(barriers), barriers, 0, 0);
+    if(slot->query_pool) {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot->query_pool, 1);
+    }
+    try(vkEndCommandBuffer(command_buffer));
+    /* the buffer written now was last drawn by frame N - 2, which signals N - 1 */
+    uint64_t wait_value = step >= 2 ? step - 1 : 0;
+    uint64_t signal_value = step + 1;
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    VkTimelineSemaphoreSubmitInfoKHR timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &wait_value,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &signal_value,
+    };
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &frame_timeline,
+        .pWaitDstStageMask = &wait_stage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &command_buffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &particles->timeline,
+    };
+    try(vkQueueSubmit(particles->queue, 1, &submit_info, VK_NULL_HANDLE));
+    slot->frame = frame;
+    slot->pending = (slot->query_pool != VK_NULL_HANDLE);
+    ++particles->steps;
+    return 0;
+error:
+    return -1;
+}
+
+/* ticks of the last step in `slot`, once per step. only call once that step completed */
+bool particles_read_timestamps(Particles *particles, size_t slot, size_t *frame, uint64_t ticks[2]) {
+    assert_arg(particles);
+    assert_arg(frame);
+    assert_arg(ticks);
+    if(slot >= array_len(particles->slots)) return false;
+    ParticlesSlot *s = array_it(particles->slots, slot);
+    if(!s->pending) return false;
+    s->pending = false;
+    *frame = s->frame;
+    VkResult result = vkGetQueryPoolResults(particles->device, s->query_pool, 0, 2, sizeof(uint64_t) * 2, ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    return result == VK_SUCCESS;
+}
+
@@ -0,0 +1,71 @@
+#ifndef PARTICLES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "gpu_memory.h"
+#include "pipeline_cache.h"
+#include "shader_registry.h"
+#include "util.h"
+
+#define PARTICLES_MAX           (1u << 24)
+#define PARTICLES_LOCAL_SIZE    256     // particles.comp local_size_x
+#define PARTICLES_SCALE         0.01f
+#define PARTICLES_DT            (1.0f / 60.0f)
+
+/* push constants of particles.comp */
+typedef struct ParticlesPush {
+    float dt;
+    uint32_t count;
+    uint32_t reset;             // the first step seeds the particles
+    float scale;
+} ParticlesPush;
+
+typedef struct ParticlesSlot {
+    VkCommandBuffer command_buffer;
+    VkQueryPool query_pool;     // begin/end of the dispatch, VK_NULL_HANDLE without timestamps
+    size_t frame;               // frame stats index of the step
+    bool pending;               // results not yet read back
+} ParticlesSlot;
+
+/* particles simulated by a compute shader and drawn as instances of the geometry.
+ * step N reads state[N % 2] and writes state[(N + 1) % 2], which frame N draws.
+ * step N only waits for frame N - 2 (the last one drawing the buffer it
+ * overwrites), so with a separate compute family it runs while frame N - 1
+ * is still drawn. Both states are shared concurrently by the two families:
+ * frame N - 1 and step N read the same buffer at the same time, an ownership
+ * release and acquire in between would serialize the queues again */
+typedef struct Particles {
+    uint32_t count;             // 0 disables the simulation
+    VkDevice device;
+    GpuMemory *gpu_memory;
+    VkQueue queue;
+    uint32_t compute_family;
+    uint32_t graphics_family;
+    VkBuffer state[2];          // InstanceData layout, storage and vertex buffer
+    GpuAllocation state_allocations[2];
+    VkBuffer velocity;          // only used by the compute queue
+    GpuAllocation velocity_allocation;
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet sets[2];    // by the state read
+    VkShaderModule module;
+    VkPipelineLayout layout;
+    VkPipeline pipeline;
+    VkCommandPool pool;
+    ParticlesSlot *slots;       // one per frame in flight
+    VkSemaphore timeline;       // step N signals N + 1
+    uint64_t steps;             // submitted steps
+} Particles;
+
+int particles_init(Particles *particles, VkDevice device, GpuMemory *gpu_memory, ShaderRegistry *shaders, PipelineCache *cache, VkQueue queue, uint32_t compute_family, uint32_t graphics_family, size_t frames_in_flight, bool timestamps);
+void particles_free(Particles *particles);
+bool particles_async(Particles *particles);
+VkBuffer particles_buffer(Particles *particles, uint64_t step);
+int particles_step(Particles *particles, size_t frame, VkSemaphore frame_timeline);
+bool particles_read_timestamps(Particles *particles, size_t slot, size_t *frame, uint64_t ticks[2]);
+
+#define PARTICLES_H
+#endif
+
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pipeline_cache.h"
+
+static uint64_t fnv1a64(const unsigned char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static unsigned char *read_file(const char *path, size_t *len) {
+    assert_arg(path);
+    assert_arg(len);
+    FILE *file = fopen(path, "rb");
+    if(!file) return 0;
+    unsigned char *data = 0;
+    if(fseek(file, 0, SEEK_END)) goto clean;
+    long size = ftell(file);
+    if(size <= 0 || fseek(file, 0, SEEK_SET)) goto clean;
+    data = malloc((size_t)size);
+    if(!data) goto clean;
+    if(fread(data, 1, (size_t)size, file) != (size_t)size) {
+        free(data);
+        data = 0;
+        goto clean;
+    }
+    *len = (size_t)size;
+clean:
+    fclose(file);
+    return data;
+}
+
+static PipelineCacheStatus validate(const unsigned char *data, size_t len, VkPhysicalDeviceProperties *properties) {
+    assert_arg(data);
+    assert_arg(properties);
+    PipelineCacheFileHeader header;
+    if(len < sizeof(header)) return PIPELINE_CACHE_CORRUPT;
+    memcpy(&header, data, sizeof(header));
+    if(header.magic != PIPELINE_CACHE_MAGIC) return PIPELINE_CACHE_CORRUPT;
+    if(header.version != PIPELINE_CACHE_VERSION) return PIPELINE_CACHE_STALE;
+    if(header.vendor_id != properties->vendorID) return PIPELINE_CACHE_STALE;
+    if(header.device_id != properties->deviceID) return PIPELINE_CACHE_STALE;
+    if(header.driver_version != properties->driverVersion) return PIPELINE_CACHE_STALE;
+    if(memcmp(header.uuid, properties->pipelineCacheUUID, VK_UUID_SIZE)) return PIPELINE_CACHE_STALE;
+    if(header.data_size != len - sizeof(header)) return PIPELINE_CACHE_CORRUPT;
+    if(header.data_hash != fnv1a64(data + sizeof(header), header.data_size)) return PIPELINE_CACHE_CORRUPT;
+    /* the driver's own header, VkPipelineCacheHeaderVersionOne */
+    const unsigned char *blob = data + sizeof(header);
+    uint32_t vk_header[4];
+    if(header.data_size < sizeof(vk_header) + VK_UUID_SIZE) return PIPELINE_CACHE_CORRUPT;
+    memcpy(vk_header, blob, sizeof(vk_header));
+    if(vk_header[0] < sizeof(vk_header) + VK_UUID_SIZE || vk_header[0] > header.data_size) return PIPELINE_CACHE_CORRUPT;
+    if(vk_header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) return PIPELINE_CACHE_STALE;
+    if(vk_header[2] != properties->vendorID) return PIPELINE_CACHE_STALE;
+    if(vk_header[3] != properties->deviceID) return PIPELINE_CACHE_STALE;
+    if(memcmp(blob + sizeof(vk_header), properties->pipelineCacheUUID, VK_UUID_SIZE)) return PIPELINE_CACHE_STALE;
+    return PIPELINE_CACHE_LOADED;
+}
+
+int pipeline_cache_create(PipelineCache *cache, VkPhysicalDevice physical, VkDevice device) {
+    assert_arg(cache);
+    assert_arg(cache->path);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical, &properties);
+    size_t len = 0;
+    unsigned char *data = read_file(cache->path, &len);
+    cache->status = data ? validate(data, len, &properties) : PIPELINE_CACHE_EMPTY;
+    cache->loaded_size = 0;
+    VkPipelineCacheCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    };
+    if(cache->status == PIPELINE_CACHE_LOADED) {
+        create_info.initialDataSize = len - sizeof(PipelineCacheFileHeader);
+        create_info.pInitialData = data + sizeof(PipelineCacheFileHeader);
+        if(vkCreatePipelineCache(device, &create_info, 0, &cache->cache) == VK_SUCCESS) {
+            cache->loaded_size = create_info.initialDataSize;
+            goto clean;
+        }
+        /* driver rejected it anyway, start over */
+        cache->status = PIPELINE_CACHE_CORRUPT;
+        create_info.initialDataSize = 0;
+        create_info.pInitialData = 0;
+    }
+    try(vkCreatePipelineCache(device, &create_info, 0, &cache->cache));
+clean:
+    free(data);
+    return 0;
+error:
+    free(data);
+    return -1;
+}
+
+int pipeline_cache_save(PipelineCache *cache, VkPhysicalDevice physical, VkDevice device) {
+    assert_arg(cache);
+    assert_arg(cache->path);
+    if(!cache->cache) return 0;
+    int err = 0;
+    unsigned char *data = 0;
+    FILE *file = 0;
+    bool created = false;   // tmp_path exists, removed on error
+    char tmp_path[4096];
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical, &properties);
+    size_t size = 0;
+    try(vkGetPipelineCacheData(device, cache->cache, &size, 0));
+    data = malloc(size);
+    if(!data) goto error;
+    try(vkGetPipelineCacheData(device, cache->cache, &size, data));
+    PipelineCacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.vendor_id = properties.vendorID;
+    header.device_id = properties.deviceID;
+    header.driver_version = properties.driverVersion;
+    memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.data_size = size;
+    header.data_hash = fnv1a64(data, size);
+    /* write next to the old file and rename, a crash never leaves a torn cache */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache->path);
+    file = fopen(tmp_path, "wb");
+    if(!file) goto error;
+    created = true;
+    if(fwrite(&header, sizeof(header), 1, file) != 1) goto error;
+    if(fwrite(data, 1, size, file) != size) goto error;
+    if(fclose(file)) {
+        file = 0;
+        goto error;
+    }
+    file = 0;
+    if(rename(tmp_path, cache->path)) goto error;
+clean:
+    free(data);
+    return err;
+error:
+    if(file) fclose(file);
+    if(created) remove(tmp_path);
+    err = -1;
+    goto clean;
+}
+
+void pipeline_cache_destroy(PipelineCache *cache, VkDevice device) {
+    assert_arg(cache);
+    if(cache->cache) {
+        vkDestroyPipelineCache(device, cache->cache, 0);
+    }
+    cache->cache = VK_NULL_HANDLE;
+}
+
+bool pipeline_cache_feedback(PipelineCache *cache, const VkPipelineCreationFeedbackEXT *feedback) {
+    assert_arg(cache);
+    assert_arg(feedback);
+    if(!(feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)) return false;
+    bool hit = feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT;
+    if(hit) ++cache->hits;
+    else ++cache->misses;
+    return hit;
+}
+
+const char *pipeline_cache_status_str(PipelineCacheStatus status) {
+    switch(status) {
+        case PIPELINE_CACHE_EMPTY: return "empty";
+        case PIPELINE_CACHE_LOADED: return "loaded";
+        case PIPELINE_CACHE_STALE: return "stale";
+        case PIPELINE_CACHE_CORRUPT: return "corrupt";
+    }
+    return "unknown";
+}
+
@@ -0,0 +1,47 @@
+#ifndef PIPELINE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <vulkan/vulkan.h>
+#include "util.h"
+
+#define PIPELINE_CACHE_MAGIC    0x48435050 // "PPCH"
+#define PIPELINE_CACHE_VERSION  1
+
+typedef enum {
+    PIPELINE_CACHE_EMPTY,       // no file on disk, start from scratch
+    PIPELINE_CACHE_LOADED,
+    PIPELINE_CACHE_STALE,       // written by another device or driver version
+    PIPELINE_CACHE_CORRUPT,     // truncated or checksum mismatch
+} PipelineCacheStatus;
+
+/* on disk: PipelineCacheFileHeader followed by vkGetPipelineCacheData */
+typedef struct PipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint8_t uuid[VK_UUID_SIZE];
+    uint64_t data_size;
+    uint64_t data_hash;
+} PipelineCacheFileHeader;
+
+typedef struct PipelineCache {
+    const char *path;
+    VkPipelineCache cache;
+    PipelineCacheStatus status;
+    size_t loaded_size;
+    size_t hits;
+    size_t misses;
+} PipelineCache;
+
+int pipeline_cache_create(PipelineCache *cache, VkPhysicalDevice physical, VkDevice device);
+int pipeline_cache_save(PipelineCache *cache, VkPhysicalDevice physical, VkDevice device);
+void pipeline_cache_destroy(PipelineCache *cache, VkDevice device);
+bool pipeline_cache_feedback(PipelineCache *cache, const VkPipelineCreationFeedbackEXT *feedback);
+const char *pipeline_cache_status_str(PipelineCacheStatus status);
+
+#define PIPELINE_CACHE_H
+#endif
+
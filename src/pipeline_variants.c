@@ -0,0 +1,395 @@
+#include <stdlib.h>
+#include <string.h>
+#include <rlc/array.h>
+#include "frame_stats.h"
+#include "geometry.h"
+#include "pipeline_variants.h"
+
+static uint64_t fnv1a64_u32(uint64_t hash, uint32_t value) {
+    for(size_t i = 0; i < sizeof(value); ++i) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+PipelineState pipeline_state_default(void) {
+    return (PipelineState){
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .polygon_mode = VK_POLYGON_MODE_FILL,
+        .cull_mode = VK_CULL_MODE_BACK_BIT,
+        .front_face = VK_FRONT_FACE_CLOCKWISE,
+        .blend = PIPELINE_BLEND_NONE,
+    };
+}
+
+/* field by field, so padding never leaks into the key */
+uint64_t pipeline_state_hash(const PipelineState *state) {
+    assert_arg(state);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fnv1a64_u32(hash, (uint32_t)state->topology);
+    hash = fnv1a64_u32(hash, (uint32_t)state->polygon_mode);
+    hash = fnv1a64_u32(hash, (uint32_t)state->cull_mode);
+    hash = fnv1a64_u32(hash, (uint32_t)state->front_face);
+    hash = fnv1a64_u32(hash, (uint32_t)state->blend);
+    for(size_t i = 0; i < PIPELINE_SPEC__COUNT; ++i) {
+        hash = fnv1a64_u32(hash, state->spec[i]);
+    }
+    return hash;
+}
+
+static bool pipeline_state_equal(const PipelineState *a, const PipelineState *b) {
+    if(a->topology != b->topology) return false;
+    if(a->polygon_mode != b->polygon_mode) return false;
+    if(a->cull_mode != b->cull_mode) return false;
+    if(a->front_face != b->front_face) return false;
+    if(a->blend != b->blend) return false;
+    return !memcmp(a->spec, b->spec, sizeof(a->spec));
+}
+
+static VkPipelineColorBlendAttachmentState pipeline_blend_attachment(PipelineBlend blend) {
+    VkPipelineColorBlendAttachmentState attachment = {
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT,
+        .blendEnable = VK_FALSE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+    };
+    switch(blend) {
+        case PIPELINE_BLEND_NONE: break;
+        case PIPELINE_BLEND_ALPHA:
+            attachment.blendEnable = VK_TRUE;
+            attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            break;
+        case PIPELINE_BLEND_ADDITIVE:
+            attachment.blendEnable = VK_TRUE;
+            attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            break;
+    }
+    return attachment;
+}
+
+static int pipeline_variant_create(PipelineVariants *variants, PipelineVariant *variant) {
+    assert_arg(variants);
+    assert_arg(variant);
+    const PipelineState *state = &variant->state;
+    /* the heap sizes are the same for every variant, so they are not part of the state */
+    uint32_t spec[PIPELINE_SPEC__COUNT];
+    memcpy(spec, state->spec, sizeof(spec));
+    spec[PIPELINE_SPEC_TEXTURES] = variants->textures;
+    spec[PIPELINE_SPEC_BUFFERS] = variants->buffers;
+    VkSpecializationMapEntry spec_entries[PIPELINE_SPEC__COUNT];
+    for(size_t i = 0; i < PIPELINE_SPEC__COUNT; ++i) {
+        spec_entries[i] = (VkSpecializationMapEntry){
+            .constantID = (uint32_t)i,
+            .offset = (uint32_t)(i * sizeof(*spec)),
+            .size = sizeof(*spec),
+        };
+    }
+    /* ids a stage does not declare are ignored, so both share the map */
+    VkSpecializationInfo spec_info = {
+        .mapEntryCount = PIPELINE_SPEC__COUNT,
+        .pMapEntries = spec_entries,
+        .dataSize = sizeof(spec),
+        .pData = spec,
+    };
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = variants->vert,
+            .pName = "main",
+            .pSpecializationInfo = &spec_info,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = variants->frag,
+            .pName = "main",
+            .pSpecializationInfo = &spec_info,
+        },
+    };
+    VkDynamicState dynamic_states[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizearray(dynamic_states),
+        .pDynamicStates = dynamic_states,
+    };
+    VkVertexInputBindingDescription binding_descriptions[2];
+    VkVertexInputAttributeDescription attribute_descriptions[4];
+    geometry_binding_descriptions(binding_descriptions);
+    geometry_attribute_descriptions(attribute_descriptions);
+    VkPipelineVertexInputStateCreateInfo vertex_input_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = sizearray(binding_descriptions),
+        .pVertexBindingDescriptions = binding_descriptions,
+        .vertexAttributeDescriptionCount = sizearray(attribute_descriptions),
+        .pVertexAttributeDescriptions = attribute_descriptions,
+    };
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = state->topology,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    /* viewport and scissor are dynamic, only the counts matter */
+    VkPipelineViewportStateCreateInfo viewport_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    VkPipelineRasterizationStateCreateInfo rasterizer = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = state->polygon_mode,
+        .lineWidth = 1.0f,
+        .cullMode = state->cull_mode,
+        .frontFace = state->front_face,
+        .depthBiasEnable = VK_FALSE,
+    };
+    VkPipelineMultisampleStateCreateInfo multisampling = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .sampleShadingEnable = VK_FALSE,
+        .rasterizationSamples = variants->samples,
+        .minSampleShading = 1.0f,
+    };
+    /* with front to back ordering, hidden fragments fail the early test */
+    VkPipelineDepthStencilStateCreateInfo depth_stencil = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = VK_COMPARE_OP_LESS,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    VkPipelineColorBlendAttachmentState color_blend_attachment = pipeline_blend_attachment(state->blend);
+    VkPipelineColorBlendStateCreateInfo color_blending = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .logicOp = VK_LOGIC_OP_COPY,
+        .attachmentCount = 1,
+        .pAttachments = &color_blend_attachment,
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = sizearray(shader_stages),
+        .pStages = shader_stages,
+        .pVertexInputState = &vertex_input_info,
+        .pInputAssemblyState = &input_assembly,
+        .pViewportState = &viewport_state,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState = &multisampling,
+        .pDepthStencilState = &depth_stencil,
+        .pColorBlendState = &color_blending,
+        .pDynamicState = &dynamic_state,
+        .layout = variants->layout,
+        .renderPass = variants->render_pass,
+        .subpass = 0,
+        .basePipelineIndex = -1,
+    };
+    VkPipelineCreationFeedbackEXT feedback = {0};
+    VkPipelineCreationFeedbackEXT stage_feedbacks[sizearray(shader_stages)] = {0};
+    VkPipelineCreationFeedbackCreateInfoEXT feedback_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT,
+        .pPipelineCreationFeedback = &feedback,
+        .pipelineStageCreationFeedbackCount = sizearray(stage_feedbacks),
+        .pPipelineStageCreationFeedbacks = stage_feedbacks,
+    };
+    if(variants->creation_feedback) {
+        pipeline_info.pNext = &feedback_info;
+    }
+    /* dynamic rendering: no render pass, the attachment formats are given here */
+    VkPipelineRenderingCreateInfoKHR rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+        .pNext = pipeline_info.pNext,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &variants->color_format,
+        .depthAttachmentFormat = variants->depth_format,
+    };
+    if(!variants->render_pass) {
+        pipeline_info.pNext = &rendering_info;
+    }
+    double t0 = frame_stats_now();
+    /* the pipeline cache is internally synchronized */
+    try(vkCreateGraphicsPipelines(variants->device, variants->cache->cache, 1, &pipeline_info, 0, &variant->pipeline));
+    variant->compile_ms = (frame_stats_now() - t0) * 1e3;
+    if(variants->creation_feedback && (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)) {
+        pthread_mutex_lock(&variants->mutex);
+        variant->cache_known = true;
+        variant->cache_hit = pipeline_cache_feedback(variants->cache, &feedback);
+        pthread_mutex_unlock(&variants->mutex);
+    }
+    return 0;
+error:
+    variant->pipeline = VK_NULL_HANDLE;
+    return -1;
+}
+
+/* a handful of variants, a linear scan over the keys is plenty */
+static PipelineVariant *pipeline_variants_find(PipelineVariants *variants, uint64_t key, const PipelineState *state) {
+    for(size_t i = 0; i < array_len(variants->variants); ++i) {
+        PipelineVariant *variant = array_at(variants->variants, i);
+        if(variant->key == key && pipeline_state_equal(&variant->state, state)) return variant;
+    }
+    return 0;
+}
+
+static PipelineVariant *pipeline_variants_add(PipelineVariants *variants, uint64_t key, const PipelineState *state, PipelineVariantStatus status) {
+    PipelineVariant *variant = malloc(sizeof(*variant));
+    if(!variant) return 0;
+    *variant = (PipelineVariant){
+        .key = key,
+        .state = *state,
+        .status = status,
+    };
+    array_push(variants->variants, variant);
+    return variant;
+}
+
+static void *pipeline_variants_worker(void *arg) {
+    PipelineVariants *variants = arg;
+    pthread_mutex_lock(&variants->mutex);
+    for(;;) {
+        while(!variants->quit && !variants->pending) {
+            pthread_cond_wait(&variants->cond, &variants->mutex);
+        }
+        if(variants->quit) break;
+        PipelineVariant *variant = 0;
+        for(size_t i = 0; i < array_len(variants->variants); ++i) {
+            variant = array_at(variants->variants, i);
+            if(variant->status == PIPELINE_VARIANT_PENDING) break;
+        }
+        variant->status = PIPELINE_VARIANT_COMPILING;
+        --variants->pending;
+        pthread_mutex_unlock(&variants->mutex);
+        int err = pipeline_variant_create(variants, variant);
+        pthread_mutex_lock(&variants->mutex);
+        variant->status = err ? PIPELINE_VARIANT_FAILED : PIPELINE_VARIANT_READY;
+        pthread_cond_broadcast(&variants->cond);
+    }
+    pthread_mutex_unlock(&variants->mutex);
+    return 0;
+}
+
+int pipeline_variants_init(PipelineVariants *variants, VkDevice device, PipelineCache *cache, VkPipelineLayout layout, VkRenderPass render_pass, VkFormat color_format, VkFormat depth_format, VkSampleCountFlagBits samples, uint32_t textures, uint32_t buffers, VkShaderModule vert, VkShaderModule frag, bool creation_feedback) {
+    assert_arg(variants);
+    assert_arg(cache);
+    variants->device = device;
+    variants->cache = cache;
+    variants->layout = layout;
+    variants->render_pass = render_pass;
+    variants->color_format = color_format;
+    variants->depth_format = depth_format;
+    variants->samples = samples;
+    variants->textures = textures;
+    variants->buffers = buffers;
+    variants->vert = vert;
+    variants->frag = frag;
+    variants->creation_feedback = creation_feedback;
+    pthread_mutex_init(&variants->mutex, 0);
+    pthread_cond_init(&variants->cond, 0);
+    array_resize(variants->workers, variants->threads);
+    for(size_t i = 0; i < variants->threads; ++i) {
+        if(pthread_create(array_it(variants->workers, i), 0, pipeline_variants_worker, variants)) {
+            println("failed to start pipeline variant thread %zu", i);
+            goto error;
+        }
+        ++variants->started;
+    }
+    return 0;
+error:
+    return -1;
+}
+
+void pipeline_variants_free(PipelineVariants *variants) {
+    assert_arg(variants);
+    if(!variants->device) return;
+    pthread_mutex_lock(&variants->mutex);
+    variants->quit = true;
+    pthread_cond_broadcast(&variants->cond);
+    pthread_mutex_unlock(&variants->mutex);
+    for(size_t i = 0; i < variants->started; ++i) {
+        pthread_join(array_at(variants->workers, i), 0);
+    }
+    for(size_t i = 0; i < array_len(variants->variants); ++i) {
+        PipelineVariant *variant = array_at(variants->variants, i);
+        if(variant->pipeline) vkDestroyPipeline(variants->device, variant->pipeline, 0);
+        free(variant);
+    }
+    array_free(variants->variants);
+    array_free(variants->workers);
+    pthread_cond_destroy(&variants->cond);
+    pthread_mutex_destroy(&variants->mutex);
+    variants->device = VK_NULL_HANDLE;
+    variants->started = 0;
+}
+
+/* blocks until the variant is ready, for pipelines that have to exist up front */
+PipelineVariant *pipeline_variants_compile(PipelineVariants *variants, const PipelineState *state) {
+    assert_arg(variants);
+    assert_arg(state);
+    uint64_t key = pipeline_state_hash(state);
+    pthread_mutex_lock(&variants->mutex);
+    PipelineVariant *variant = pipeline_variants_find(variants, key, state);
+    if(variant) {
+        while(variant->status == PIPELINE_VARIANT_PENDING || variant->status == PIPELINE_VARIANT_COMPILING) {
+            pthread_cond_wait(&variants->cond, &variants->mutex);
+        }
+        pthread_mutex_unlock(&variants->mutex);
+        return variant->status == PIPELINE_VARIANT_READY ? variant : 0;
+    }
+    variant = pipeline_variants_add(variants, key, state, PIPELINE_VARIANT_COMPILING);
+    pthread_mutex_unlock(&variants->mutex);
+    if(!variant) return 0;
+    int err = pipeline_variant_create(variants, variant);
+    pthread_mutex_lock(&variants->mutex);
+    variant->status = err ? PIPELINE_VARIANT_FAILED : PIPELINE_VARIANT_READY;
+    pthread_cond_broadcast(&variants->cond);
+    pthread_mutex_unlock(&variants->mutex);
+    return err ? 0 : variant;
+}
+
+/* never blocks with worker threads: queues a miss and returns the fallback until it is ready */
+VkPipeline pipeline_variants_get(PipelineVariants *variants, const PipelineState *state, VkPipeline fallback) {
+    assert_arg(variants);
+    assert_arg(state);
+    if(!variants->started) {
+        PipelineVariant *variant = pipeline_variants_compile(variants, state);
+        return variant ? variant->pipeline : fallback;
+    }
+    uint64_t key = pipeline_state_hash(state);
+    VkPipeline pipeline = fallback;
+    pthread_mutex_lock(&variants->mutex);
+    PipelineVariant *variant = pipeline_variants_find(variants, key, state);
+    if(!variant) {
+        variant = pipeline_variants_add(variants, key, state, PIPELINE_VARIANT_PENDING);
+        if(variant) {
+            ++variants->pending;
+            pthread_cond_broadcast(&variants->cond);
+        }
+    }
+    if(variant && variant->status == PIPELINE_VARIANT_READY) {
+        pipeline = variant->pipeline;
+        ++variants->hits;
+    } else {
+        ++variants->fallbacks;
+    }
+    pthread_mutex_unlock(&variants->mutex);
+    return pipeline;
+}
+
+size_t pipeline_variants_count(PipelineVariants *variants) {
+    assert_arg(variants);
+    pthread_mutex_lock(&variants->mutex);
+    size_t count = array_len(variants->variants);
+    pthread_mutex_unlock(&variants->mutex);
+    return count;
+}
+
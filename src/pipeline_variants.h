@@ -0,0 +1,91 @@
+#ifndef PIPELINE_VARIANTS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "pipeline_cache.h"
+#include "util.h"
+
+#define PIPELINE_VARIANTS_THREADS   2
+
+typedef enum {
+    PIPELINE_BLEND_NONE,
+    PIPELINE_BLEND_ALPHA,
+    PIPELINE_BLEND_ADDITIVE,
+} PipelineBlend;
+
+/* specialization constants, the index is the constant_id in the shaders */
+typedef enum {
+    PIPELINE_SPEC_COLOR_MODE,   // shader.frag: 0 vertex color, 1 grayscale
+    PIPELINE_SPEC_TEXTURES,     // shader.frag: bindless texture array size, set by the variants
+    PIPELINE_SPEC_BUFFERS,      // shader.frag: bindless buffer array size, set by the variants
+    /* add above */
+    PIPELINE_SPEC__COUNT,
+} PipelineSpec;
+
+/* everything that makes a variant, hashed field by field */
+typedef struct PipelineState {
+    VkPrimitiveTopology topology;
+    VkPolygonMode polygon_mode;
+    VkCullModeFlags cull_mode;
+    VkFrontFace front_face;
+    PipelineBlend blend;
+    uint32_t spec[PIPELINE_SPEC__COUNT];
+} PipelineState;
+
+typedef enum {
+    PIPELINE_VARIANT_PENDING,   // queued for a worker
+    PIPELINE_VARIANT_COMPILING,
+    PIPELINE_VARIANT_READY,
+    PIPELINE_VARIANT_FAILED,
+} PipelineVariantStatus;
+
+typedef struct PipelineVariant {
+    uint64_t key;
+    PipelineState state;
+    PipelineVariantStatus status;
+    VkPipeline pipeline;
+    double compile_ms;
+    bool cache_known;           // creation feedback was valid
+    bool cache_hit;
+} PipelineVariant;
+
+/* every variant compiled once, misses compile on worker threads while the caller draws a fallback */
+typedef struct PipelineVariants {
+    size_t threads;             // 0 compiles inline on the first request
+    VkDevice device;
+    PipelineCache *cache;
+    VkPipelineLayout layout;
+    VkRenderPass render_pass;   // VK_NULL_HANDLE: dynamic rendering
+    VkFormat color_format;      // only used with dynamic rendering
+    VkFormat depth_format;      // only used with dynamic rendering
+    VkSampleCountFlagBits samples;
+    uint32_t textures;          // PIPELINE_SPEC_TEXTURES of every variant
+    uint32_t buffers;           // PIPELINE_SPEC_BUFFERS of every variant
+    VkShaderModule vert;
+    VkShaderModule frag;
+    bool creation_feedback;     // VK_EXT_pipeline_creation_feedback
+    PipelineVariant **variants; // pointers stay valid while workers compile
+    pthread_t *workers;
+    size_t started;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    size_t pending;
+    bool quit;
+    size_t hits;                // lookups that found a ready variant
+    size_t fallbacks;           // lookups that had to draw the fallback
+} PipelineVariants;
+
+PipelineState pipeline_state_default(void);
+uint64_t pipeline_state_hash(const PipelineState *state);
+int pipeline_variants_init(PipelineVariants *variants, VkDevice device, PipelineCache *cache, VkPipelineLayout layout, VkRenderPass render_pass, VkFormat color_format, VkFormat depth_format, VkSampleCountFlagBits samples, uint32_t textures, uint32_t buffers, VkShaderModule vert, VkShaderModule frag, bool creation_feedback);
+void pipeline_variants_free(PipelineVariants *variants);
+PipelineVariant *pipeline_variants_compile(PipelineVariants *variants, const PipelineState *state);
+VkPipeline pipeline_variants_get(PipelineVariants *variants, const PipelineState *state, VkPipeline fallback);
+size_t pipeline_variants_count(PipelineVariants *variants);
+
+#define PIPELINE_VARIANTS_H
+#endif
+
@@ -5,6 +5,8 @@
 typedef struct QueueFamilyIndices {
     OptionalU32 graphics_family;
     OptionalU32 present_family;
+    OptionalU32 transfer_family;    // dedicated if available, graphics otherwise
+    OptionalU32 compute_family;     // async (no graphics) if available, graphics otherwise
 } QueueFamilyIndices;
 
 void queue_family_indices_clear(QueueFamilyIndices *indices);
@@ -0,0 +1,209 @@
+#include <string.h>
+#include <rlc/array.h>
+#include "recorder.h"
+
+/* whole batches per thread, so every draw is recorded by exactly one of them */
+static void recorder_slice(Recorder *recorder, size_t index, Geometry *geometry, uint32_t *first, uint32_t *slice) {
+    assert_arg(recorder);
+    assert_arg(geometry);
+    assert_arg(first);
+    assert_arg(slice);
+    uint32_t batches = geometry_batches(geometry);
+    uint32_t per_thread = (uint32_t)((batches + recorder->threads - 1) / recorder->threads);
+    uint32_t begin = (uint32_t)index * per_thread;
+    uint32_t end = begin + per_thread;
+    if(begin > batches) begin = batches;
+    if(end > batches) end = batches;
+    *first = geometry_batch_first(geometry, begin);
+    *slice = geometry_batch_first(geometry, end) - *first;
+}
+
+static int recorder_worker_record(RecorderWorker *worker, RecorderJob *job) {
+    assert_arg(worker);
+    assert_arg(job);
+    Recorder *recorder = worker->recorder;
+    VkCommandPool pool = array_at(worker->pools, job->frame);
+    VkCommandBuffer command_buffer = array_at(worker->buffers, job->frame);
+    uint32_t first = 0, slice = 0;
+    recorder_slice(recorder, worker->index, job->geometry, &first, &slice);
+    if(!slice) return 0;
+    /* resetting the whole pool is cheaper than resetting single buffers */
+    try(vkResetCommandPool(recorder->device, pool, 0));
+    VkCommandBufferInheritanceInfo inheritance_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .renderPass = job->render_pass,
+        .subpass = 0,
+        .framebuffer = job->framebuffer,
+    };
+    /* dynamic rendering: the secondaries continue a vkCmdBeginRenderingKHR instead */
+    VkCommandBufferInheritanceRenderingInfoKHR rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &job->color_format,
+        .depthAttachmentFormat = job->depth_format,
+        .rasterizationSamples = job->samples,
+    };
+    if(!job->render_pass) {
+        inheritance_info.pNext = &rendering_info;
+    }
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = &inheritance_info,
+    };
+    try(vkBeginCommandBuffer(command_buffer, &begin_info));
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, job->pipeline);
+    /* neither are bound sets, or dynamic state */
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, job->layout, 0, 2, job->descriptor_sets, 1, &job->frame_offset);
+    VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width  = (float)job->extent.width,
+        .height  = (float)job->extent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    VkRect2D scissor = {
+        .offset = {0, 0},
+        .extent = job->extent,
+    };
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    geometry_draw_materials(job->geometry, command_buffer, job->layout, first, slice, job->texture, job->materials, job->material_count);
+    if(worker->index == 0 && job->particles) {
+        BindlessPush push = {
+            .texture = BINDLESS_DEFAULT,
+            .material = BINDLESS_DEFAULT,
+        };
+        vkCmdPushConstants(command_buffer, job->layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+        geometry_draw_instances(job->geometry, command_buffer, job->particles, job->particle_count);
+    }
+    try(vkEndCommandBuffer(command_buffer));
+    return 0;
+error:
+    return -1;
+}
+
+static void *recorder_worker(void *arg) {
+    RecorderWorker *worker = arg;
+    Recorder *recorder = worker->recorder;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&recorder->mutex);
+    for(;;) {
+        while(!recorder->quit && recorder->generation == seen) {
+            pthread_cond_wait(&recorder->start, &recorder->mutex);
+        }
+        if(recorder->quit) break;
+        seen = recorder->generation;
+        RecorderJob job = recorder->job;
+        pthread_mutex_unlock(&recorder->mutex);
+        worker->err = recorder_worker_record(worker, &job);
+        pthread_mutex_lock(&recorder->mutex);
+        if(++recorder->finished == recorder->started) {
+            pthread_cond_signal(&recorder->finish);
+        }
+    }
+    pthread_mutex_unlock(&recorder->mutex);
+    return 0;
+}
+
+int recorder_init(Recorder *recorder, VkDevice device, uint32_t queue_family, size_t frames_in_flight) {
+    assert_arg(recorder);
+    if(!recorder->threads) return 0;
+    if(recorder->threads > RECORDER_THREADS_MAX) recorder->threads = RECORDER_THREADS_MAX;
+    recorder->device = device;
+    pthread_mutex_init(&recorder->mutex, 0);
+    pthread_cond_init(&recorder->start, 0);
+    pthread_cond_init(&recorder->finish, 0);
+    /* sized once, the threads keep pointers into it */
+    array_resize(recorder->workers, recorder->threads);
+    memset(recorder->workers, 0, sizeof(*recorder->workers) * recorder->threads);
+    for(size_t i = 0; i < recorder->threads; ++i) {
+        RecorderWorker *worker = array_it(recorder->workers, i);
+        worker->recorder = recorder;
+        worker->index = i;
+        array_resize(worker->pools, frames_in_flight);
+        array_resize(worker->buffers, frames_in_flight);
+        memset(worker->pools, 0, sizeof(*worker->pools) * frames_in_flight);
+        for(size_t j = 0; j < frames_in_flight; ++j) {
+            VkCommandPoolCreateInfo pool_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                .queueFamilyIndex = queue_family,
+            };
+            VkCommandPool *pool = array_it(worker->pools, j);
+            try(vkCreateCommandPool(device, &pool_info, 0, pool));
+            VkCommandBufferAllocateInfo alloc_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .commandPool = *pool,
+                .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+                .commandBufferCount = 1,
+            };
+            try(vkAllocateCommandBuffers(device, &alloc_info, array_it(worker->buffers, j)));
+        }
+    }
+    for(size_t i = 0; i < recorder->threads; ++i) {
+        RecorderWorker *worker = array_it(recorder->workers, i);
+        if(pthread_create(&worker->thread, 0, recorder_worker, worker)) {
+            println("failed to start recorder thread %zu", i);
+            goto error;
+        }
+        ++recorder->started;
+    }
+    return 0;
+error:
+    return -1;
+}
+
+void recorder_free(Recorder *recorder) {
+    assert_arg(recorder);
+    if(!recorder->device) return;
+    pthread_mutex_lock(&recorder->mutex);
+    recorder->quit = true;
+    pthread_cond_broadcast(&recorder->start);
+    pthread_mutex_unlock(&recorder->mutex);
+    for(size_t i = 0; i < recorder->started; ++i) {
+        RecorderWorker *worker = array_it(recorder->workers, i);
+        pthread_join(worker->thread, 0);
+    }
+    for(size_t i = 0; i < array_len(recorder->workers); ++i) {
+        RecorderWorker *worker = array_it(recorder->workers, i);
+        for(size_t j = 0; j < array_len(worker->pools); ++j) {
+            VkCommandPool pool = array_at(worker->pools, j);
+            if(pool) vkDestroyCommandPool(recorder->device, pool, 0);
+        }
+        array_free(worker->pools);
+        array_free(worker->buffers);
+    }
+    array_free(recorder->workers);
+    array_free(recorder->recorded);
+    pthread_cond_destroy(&recorder->finish);
+    pthread_cond_destroy(&recorder->start);
+    pthread_mutex_destroy(&recorder->mutex);
+    recorder->device = VK_NULL_HANDLE;
+    recorder->started = 0;
+}
+
+int recorder_record(Recorder *recorder, RecorderJob *job) {
+    assert_arg(recorder);
+    assert_arg(job);
+    pthread_mutex_lock(&recorder->mutex);
+    recorder->job = *job;
+    recorder->finished = 0;
+    ++recorder->generation;
+    pthread_cond_broadcast(&recorder->start);
+    while(recorder->finished < recorder->started) {
+        pthread_cond_wait(&recorder->finish, &recorder->mutex);
+    }
+    pthread_mutex_unlock(&recorder->mutex);
+    array_clear(recorder->recorded);
+    for(size_t i = 0; i < array_len(recorder->workers); ++i) {
+        RecorderWorker *worker = array_it(recorder->workers, i);
+        if(worker->err) return -1;
+        uint32_t first = 0, slice = 0;
+        recorder_slice(recorder, i, job->geometry, &first, &slice);
+        if(slice) array_push(recorder->recorded, array_at(worker->buffers, job->frame));
+    }
+    return 0;
+}
+
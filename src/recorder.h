@@ -0,0 +1,66 @@
+#ifndef RECORDER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "geometry.h"
+#include "util.h"
+
+#define RECORDER_THREADS_MAX    64
+
+/* what every worker records into its secondary command buffer */
+typedef struct RecorderJob {
+    VkRenderPass render_pass;   // VK_NULL_HANDLE: dynamic rendering
+    VkFramebuffer framebuffer;
+    VkFormat color_format;      // only used with dynamic rendering
+    VkFormat depth_format;      // only used with dynamic rendering
+    VkSampleCountFlagBits samples;
+    VkExtent2D extent;
+    VkPipeline pipeline;
+    VkPipelineLayout layout;
+    VkDescriptorSet descriptor_sets[2]; // the bindless set, the frame uniforms
+    uint32_t frame_offset;      // dynamic offset of the frame's FrameData
+    Geometry *geometry;
+    uint32_t texture;           // bindless texture slot of the instances
+    const uint32_t *materials;  // bindless buffer slots, instances split evenly between them
+    uint32_t material_count;
+    VkBuffer particles;         // instances drawn by the first worker, VK_NULL_HANDLE for none
+    uint32_t particle_count;
+    size_t frame;               // frame in flight, selects the pool
+} RecorderJob;
+
+struct Recorder;
+
+typedef struct RecorderWorker {
+    struct Recorder *recorder;
+    pthread_t thread;
+    size_t index;
+    VkCommandPool *pools;       // one per frame in flight, only touched by this thread
+    VkCommandBuffer *buffers;   // secondary, one per frame in flight
+    int err;
+} RecorderWorker;
+
+/* worker threads recording secondary command buffers, each one a slice of the instances */
+typedef struct Recorder {
+    size_t threads;             // 0 records inline on the main thread
+    VkDevice device;
+    RecorderWorker *workers;
+    size_t started;             // running threads
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t finish;
+    uint64_t generation;        // bumped for every job
+    size_t finished;
+    bool quit;
+    RecorderJob job;
+    VkCommandBuffer *recorded;  // secondaries of the last job, in draw order
+} Recorder;
+
+int recorder_init(Recorder *recorder, VkDevice device, uint32_t queue_family, size_t frames_in_flight);
+void recorder_free(Recorder *recorder);
+int recorder_record(Recorder *recorder, RecorderJob *job);
+
+#define RECORDER_H
+#endif
+
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+#include <rlc/array.h>
+#include "shader_registry.h"
+
+#ifdef SHADERS_ARCHIVE
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* development builds: map the archive, modules are used in place */
+static int shader_registry_map(ShaderRegistry *registry) {
+    assert_arg(registry);
+    const char *path = registry->path ? registry->path : SHADERS_ARCHIVE;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        println("could not open shader archive '%s'", path);
+        goto error;
+    }
+    struct stat st;
+    if(fstat(fd, &st) || (size_t)st.st_size < sizeof(ShaderArchiveHeader)) {
+        close(fd);
+        println("shader archive too small");
+        goto error;
+    }
+    void *map = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        println("could not map shader archive");
+        goto error;
+    }
+    registry->map = map;
+    registry->map_size = (size_t)st.st_size;
+    const ShaderArchiveHeader *header = map;
+    if(header->magic != SHADER_ARCHIVE_MAGIC) {
+        println("not a shader archive");
+        goto error;
+    }
+    if(header->version != SHADER_ARCHIVE_VERSION) {
+        println("shader archive version mismatch");
+        goto error;
+    }
+    if(sizeof(*header) + (size_t)header->count * sizeof(ShaderArchiveEntry) > registry->map_size) {
+        println("shader archive entries truncated");
+        goto error;
+    }
+    const ShaderArchiveEntry *entries = (const ShaderArchiveEntry *)(header + 1);
+    for(size_t i = 0; i < header->count; ++i) {
+        const ShaderArchiveEntry *entry = &entries[i];
+        if(entry->name[SHADER_NAME_SIZE - 1]) {
+            println("shader archive name not terminated");
+            goto error;
+        }
+        if(entry->offset % sizeof(uint32_t)) {
+            println("shader archive module misaligned");
+            goto error;
+        }
+        if((size_t)entry->offset + entry->size > registry->map_size) {
+            println("shader archive module truncated");
+            goto error;
+        }
+        ShaderBlob blob = {
+            .name = entry->name,
+            .code = (const uint32_t *)((const char *)map + entry->offset),
+            .size = entry->size,
+        };
+        array_push(registry->blobs, blob);
+    }
+    return 0;
+error:
+    return -1;
+}
+#endif
+
+int shader_registry_init(ShaderRegistry *registry) {
+    assert_arg(registry);
+#ifdef SHADERS_ARCHIVE
+    if(shader_registry_map(registry)) {
+        shader_registry_free(registry);
+        return -1;
+    }
+#else
+    /* production builds: the table is part of the binary, nothing to load */
+    for(size_t i = 0; i < shader_embedded_count; ++i) {
+        array_push(registry->blobs, shader_embedded[i]);
+    }
+#endif
+    return 0;
+}
+
+static int shader_blob_cmp(const void *key, const void *blob) {
+    return strcmp(key, ((const ShaderBlob *)blob)->name);
+}
+
+const ShaderBlob *shader_registry_find(ShaderRegistry *registry, const char *name) {
+    assert_arg(registry);
+    assert_arg(name);
+    if(!array_len(registry->blobs)) return 0;
+    return bsearch(name, registry->blobs, array_len(registry->blobs), sizeof(*registry->blobs), shader_blob_cmp);
+}
+
+size_t shader_registry_count(ShaderRegistry *registry) {
+    assert_arg(registry);
+    return array_len(registry->blobs);
+}
+
+int shader_registry_create_module(ShaderRegistry *registry, VkDevice device, const char *name, VkShaderModule *module) {
+    assert_arg(registry);
+    assert_arg(name);
+    assert_arg(module);
+    const ShaderBlob *blob = shader_registry_find(registry, name);
+    if(!blob) {
+        println("shader '%s' not in registry", name);
+        goto error;
+    }
+    VkShaderModuleCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = blob->size,
+        .pCode = blob->code,
+    };
+    try(vkCreateShaderModule(device, &create_info, 0, module));
+    return 0;
+error:
+    return -1;
+}
+
+void shader_registry_free(ShaderRegistry *registry) {
+    assert_arg(registry);
+    array_free(registry->blobs);
+#ifdef SHADERS_ARCHIVE
+    if(registry->map) munmap(registry->map, registry->map_size);
+#endif
+    registry->map = 0;
+    registry->map_size = 0;
+}
+
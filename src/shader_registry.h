@@ -0,0 +1,52 @@
+#ifndef SHADER_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "util.h"
+
+#define SHADER_ARCHIVE_MAGIC    0x4b415053 // "SPAK"
+#define SHADER_ARCHIVE_VERSION  1
+#define SHADER_NAME_SIZE        48
+
+/* one SPIR-V module, code points into the binary or the mapped archive */
+typedef struct ShaderBlob {
+    const char *name;
+    const uint32_t *code;
+    size_t size;                // bytes
+} ShaderBlob;
+
+/* on disk, written by src/shaders/pack.py: header, entries sorted by name, modules */
+typedef struct ShaderArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} ShaderArchiveHeader;
+
+typedef struct ShaderArchiveEntry {
+    char name[SHADER_NAME_SIZE];
+    uint32_t offset;            // from the start of the archive
+    uint32_t size;
+} ShaderArchiveEntry;
+
+typedef struct ShaderRegistry {
+    const char *path;           // archive, only used by archive builds
+    void *map;
+    size_t map_size;
+    ShaderBlob *blobs;          // sorted by name
+} ShaderRegistry;
+
+/* generated by pack.py --embed, only linked into embed builds */
+extern const ShaderBlob shader_embedded[];
+extern const size_t shader_embedded_count;
+
+int shader_registry_init(ShaderRegistry *registry);
+const ShaderBlob *shader_registry_find(ShaderRegistry *registry, const char *name);
+size_t shader_registry_count(ShaderRegistry *registry);
+int shader_registry_create_module(ShaderRegistry *registry, VkDevice device, const char *name, VkShaderModule *module);
+void shader_registry_free(ShaderRegistry *registry);
+
+#define SHADER_REGISTRY_H
+#endif
+
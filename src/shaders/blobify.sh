@@ -1,8 +0,0 @@
-#!/bin/sh
-
-dir="$(dirname ${BASH_SOURCE})"
-
-for f in $*; do
-    xxd -i "${f}"
-done #> $dir/blob.h
-
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+# pack compiled SPIR-V modules for the shader registry (src/shader_registry.c)
+#
+#   pack.py --embed shaders_embed.c --report report.txt a.vert.spv b.frag.spv
+#   pack.py --archive shaders.pak --report report.txt a.vert.spv b.frag.spv
+#
+# modules are named after their file without .spv and sorted by name, so the
+# registry can bsearch the table. The archive is laid out to be used straight
+# from mmap: header, entries, then every module 16 byte aligned.
+
+import argparse
+import os
+import struct
+import sys
+
+SPIRV_MAGIC = 0x07230203
+ARCHIVE_MAGIC = 0x4b415053  # "SPAK"
+ARCHIVE_VERSION = 1
+NAME_SIZE = 48              # SHADER_NAME_SIZE
+ALIGN = 16
+
+
+def load(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) < 20 or len(data) % 4:
+        sys.exit(f'{path}: not a SPIR-V module')
+    words = struct.unpack(f'<{len(data) // 4}I', data)
+    if words[0] != SPIRV_MAGIC:
+        sys.exit(f'{path}: bad SPIR-V magic')
+    name = os.path.basename(path)
+    if name.endswith('.spv'):
+        name = name[:-4]
+    if len(name) >= NAME_SIZE:
+        sys.exit(f'{path}: name longer than {NAME_SIZE - 1}')
+    return name, data, words
+
+
+def instructions(words):
+    count = 0
+    i = 5
+    while i < len(words):
+        length = words[i] >> 16
+        if not length:
+            break
+        count += 1
+        i += length
+    return count
+
+
+def report(modules, path):
+    lines = [f'{"module":<24} {"bytes":>8} {"instructions":>12} {"bound":>6}']
+    total_bytes = total_instructions = 0
+    for name, data, words in modules:
+        n = instructions(words)
+        total_bytes += len(data)
+        total_instructions += n
+        lines.append(f'{name:<24} {len(data):>8} {n:>12} {words[3]:>6}')
+    lines.append(f'{"total":<24} {total_bytes:>8} {total_instructions:>12}')
+    text = '\n'.join(lines) + '\n'
+    sys.stdout.write(text)
+    if path:
+        with open(path, 'w') as f:
+            f.write(text)
+
+
+def write_embed(modules, path):
+    out = ['/* generated by src/shaders/pack.py, do not edit */',
+           '#include "shader_registry.h"', '']
+    for i, (name, data, words) in enumerate(modules):
+        out.append(f'/* {name} */')
+        out.append(f'static const uint32_t shader_code_{i}[] = {{')
+        for j in range(0, len(words), 6):
+            out.append('    ' + ' '.join(f'0x{w:08x},' for w in words[j:j + 6]))
+        out.append('};')
+        out.append('')
+    out.append('const ShaderBlob shader_embedded[] = {')
+    for i, (name, data, words) in enumerate(modules):
+        out.append(f'    {{ "{name}", shader_code_{i}, sizeof(shader_code_{i}) }},')
+    out.append('};')
+    out.append(f'const size_t shader_embedded_count = {len(modules)};')
+    with open(path, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+def write_archive(modules, path):
+    header = struct.pack('<4I', ARCHIVE_MAGIC, ARCHIVE_VERSION, len(modules), 0)
+    offset = len(header) + len(modules) * (NAME_SIZE + 8)
+    entries = b''
+    blobs = b''
+    for name, data, words in modules:
+        pad = -(offset + len(blobs)) % ALIGN
+        blobs += b'\0' * pad
+        entries += struct.pack(f'<{NAME_SIZE}sII', name.encode(), offset + len(blobs), len(data))
+        blobs += data
+    with open(path + '.tmp', 'wb') as f:
+        f.write(header + entries + blobs)
+    os.replace(path + '.tmp', path)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    mode = parser.add_mutually_exclusive_group(required=True)
+    mode.add_argument('--embed', metavar='C_FILE')
+    mode.add_argument('--archive', metavar='PAK_FILE')
+    parser.add_argument('--report', metavar='TXT_FILE')
+    parser.add_argument('modules', nargs='+')
+    args = parser.parse_args()
+    modules = sorted((load(path) for path in args.modules), key=lambda m: m[0])
+    for a, b in zip(modules, modules[1:]):
+        if a[0] == b[0]:
+            sys.exit(f'duplicate shader name {a[0]}')
+    if args.embed:
+        write_embed(modules, args.embed)
+    else:
+        write_archive(modules, args.archive)
+    report(modules, args.report)
+
+
+if __name__ == '__main__':
+    main()
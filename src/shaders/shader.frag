@@ -1,10 +1,30 @@
 #version 450
 
+layout(constant_id = 0) const uint COLOR_MODE = 0;   // PIPELINE_SPEC_COLOR_MODE: 0 vertex color, 1 grayscale
+layout(constant_id = 1) const uint TEXTURES = 1;     // PIPELINE_SPEC_TEXTURES
+layout(constant_id = 2) const uint BUFFERS = 1;      // PIPELINE_SPEC_BUFFERS
+
+/* the bindless heap, bound once. every slot holds a valid descriptor */
+layout(set = 0, binding = 0) uniform sampler2D textures[TEXTURES];
+layout(std430, set = 0, binding = 1) readonly buffer Material {
+    vec4 tint;
+} materials[BUFFERS];
+
+/* BindlessPush, the same for the whole draw so the indices are dynamically uniform */
+layout(push_constant) uniform Push {
+    uint texture;
+    uint material;
+} push;
+
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUV;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor * materials[push.material].tint.rgb * texture(textures[push.texture], fragUV).rgb;
+    if(COLOR_MODE == 1) {
+        color = vec3(dot(color, vec3(0.299, 0.587, 0.114)));
+    }
+    outColor = vec4(color, 1.0);
 }
-
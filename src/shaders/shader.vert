@@ -1,21 +1,26 @@
 #version 450
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec4 inTransform;       // offset.xy, scale, rotation
+layout(location = 3) in vec4 inInstanceColor;    // rgb, depth
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+/* FrameData, one per frame in a ring with a dynamic offset */
+layout(set = 1, binding = 0) uniform Frame {
+    vec4 view;          // camera center.xy, zoom
+    vec4 time;          // seconds, delta, frame
+} frame;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    float c = cos(inTransform.w);
+    float s = sin(inTransform.w);
+    vec2 position = inPosition * inTransform.z;
+    position = vec2(c * position.x - s * position.y, s * position.x + c * position.y);
+    position = (position + inTransform.xy - frame.view.xy) * frame.view.z;
+    gl_Position = vec4(position, inInstanceColor.a, 1.0);
+    fragColor = inColor * inInstanceColor.rgb;
+    fragUV = inPosition + 0.5;
 }
-
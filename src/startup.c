@@ -0,0 +1,143 @@
+#include <stdarg.h>
+#include <rlc/array.h>
+#include "log.h"
+#include "startup.h"
+
+typedef struct StartupWorker {
+    Startup *startup;
+    int thread;
+} StartupWorker;
+
+size_t startup_add(Startup *startup, const char *name, StartupFn fn, bool main_thread, ...) {
+    assert_arg(startup);
+    assert_arg(name);
+    assert_arg(fn);
+    StartupStep step = {
+        .name = name,
+        .fn = fn,
+        .main_thread = main_thread,
+    };
+    va_list args;
+    va_start(args, main_thread);
+    for(size_t dep = va_arg(args, size_t); dep != STARTUP_END; dep = va_arg(args, size_t)) {
+        /* steps are added in a valid sequential order, so dependencies come first */
+        assert(dep < array_len(startup->steps) && "dependency added later");
+        assert(step.dep_count < STARTUP_DEPS_MAX && "too many dependencies");
+        step.deps[step.dep_count++] = dep;
+    }
+    va_end(args);
+    step.waiting = step.dep_count;
+    array_push(startup->steps, step);
+    return array_len(startup->steps) - 1;
+}
+
+static StartupStep *startup_next(Startup *startup, bool main_thread) {
+    assert_arg(startup);
+    for(size_t i = 0; i < array_len(startup->steps); ++i) {
+        StartupStep *step = array_it(startup->steps, i);
+        if(step->state != STARTUP_PENDING || step->waiting) continue;
+        if(step->main_thread && !main_thread) continue;
+        return step;
+    }
+    return 0;
+}
+
+static void startup_loop(Startup *startup, int thread) {
+    assert_arg(startup);
+    pthread_mutex_lock(&startup->mutex);
+    while(startup->done < array_len(startup->steps) && !startup->failed) {
+        StartupStep *step = startup_next(startup, thread == 0);
+        if(!step) {
+            pthread_cond_wait(&startup->cond, &startup->mutex);
+            continue;
+        }
+        step->state = STARTUP_RUNNING;
+        step->thread = thread;
+        StartupFn fn = step->fn;
+        size_t index = step - startup->steps;
+        pthread_mutex_unlock(&startup->mutex);
+        double begin = log_now();
+        int err = fn(startup->app);
+        double end = log_now();
+        pthread_mutex_lock(&startup->mutex);
+        step = array_it(startup->steps, index);
+        step->begin = begin - startup->t0;
+        step->end = end - startup->t0;
+        step->state = err ? STARTUP_FAILED : STARTUP_DONE;
+        if(err) startup->failed = true;
+        for(size_t i = index + 1; i < array_len(startup->steps); ++i) {
+            StartupStep *dependent = array_it(startup->steps, i);
+            for(size_t j = 0; j < dependent->dep_count; ++j) {
+                if(dependent->deps[j] == index) --dependent->waiting;
+            }
+        }
+        ++startup->done;
+        if(step->end > startup->wall) startup->wall = step->end;
+        pthread_cond_broadcast(&startup->cond);
+    }
+    pthread_mutex_unlock(&startup->mutex);
+}
+
+static void *startup_worker(void *arg) {
+    StartupWorker *worker = arg;
+    startup_loop(worker->startup, worker->thread);
+    return 0;
+}
+
+int startup_run(Startup *startup, struct App *app) {
+    assert_arg(startup);
+    assert_arg(app);
+    startup->app = app;
+    startup->done = 0;
+    startup->failed = false;
+    startup->wall = 0;
+    startup->t0 = log_now();
+    if(startup->log) log_inherit(startup->log);
+    pthread_mutex_init(&startup->mutex, 0);
+    pthread_cond_init(&startup->cond, 0);
+    pthread_t threads[STARTUP_THREADS];
+    StartupWorker workers[STARTUP_THREADS];
+    size_t started = 0;
+    size_t count = startup->threads < STARTUP_THREADS ? startup->threads : STARTUP_THREADS;
+    for(; started < count; ++started) {
+        workers[started] = (StartupWorker){
+            .startup = startup,
+            .thread = (int)started + 1,
+        };
+        /* fewer workers only means less parallelism */
+        if(pthread_create(&threads[started], 0, startup_worker, &workers[started])) break;
+    }
+    startup_loop(startup, 0);
+    for(size_t i = 0; i < started; ++i) {
+        pthread_join(threads[i], 0);
+    }
+    pthread_cond_destroy(&startup->cond);
+    pthread_mutex_destroy(&startup->mutex);
+    return startup->failed ? -1 : 0;
+}
+
+/* longest chain of dependent steps, what the wall time can't go below */
+double startup_critical_path(Startup *startup) {
+    assert_arg(startup);
+    double longest = 0;
+    double *finish = 0;
+    array_resize(finish, array_len(startup->steps));
+    for(size_t i = 0; i < array_len(startup->steps); ++i) {
+        StartupStep *step = array_it(startup->steps, i);
+        double ready = 0;
+        for(size_t j = 0; j < step->dep_count; ++j) {
+            double dep = array_at(finish, step->deps[j]);
+            if(dep > ready) ready = dep;
+        }
+        *array_it(finish, i) = ready + (step->end - step->begin);
+        if(array_at(finish, i) > longest) longest = array_at(finish, i);
+    }
+    array_free(finish);
+    return longest;
+}
+
+void startup_free(Startup *startup) {
+    assert_arg(startup);
+    array_free(startup->steps);
+}
+
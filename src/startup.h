@@ -0,0 +1,58 @@
+#ifndef STARTUP_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "util.h"
+
+#define STARTUP_END         SIZE_MAX    // terminates the dependency list of startup_add
+#define STARTUP_DEPS_MAX    8
+#define STARTUP_THREADS     3           // workers besides the calling thread
+
+struct App;
+struct Log;
+typedef int (*StartupFn)(struct App *app);
+
+typedef enum {
+    STARTUP_PENDING,
+    STARTUP_RUNNING,
+    STARTUP_DONE,
+    STARTUP_FAILED,
+} StartupState;
+
+typedef struct StartupStep {
+    const char *name;
+    StartupFn fn;
+    bool main_thread;               // glfw window functions, only the calling thread runs it
+    size_t deps[STARTUP_DEPS_MAX];
+    size_t dep_count;
+    size_t waiting;                 // dependencies not done yet
+    StartupState state;
+    double begin;                   // seconds since startup_run
+    double end;
+    int thread;                     // 0 is the calling thread
+} StartupStep;
+
+/* init steps as a dependency graph, independent ones run in parallel */
+typedef struct Startup {
+    struct App *app;
+    StartupStep *steps;
+    size_t threads;                 // 0 runs everything on the calling thread, in order
+    struct Log *log;                // the workers' steps nest where startup_run was called, may be 0
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    size_t done;
+    bool failed;
+    double t0;
+    double wall;                    // seconds from start to the last step done
+} Startup;
+
+size_t startup_add(Startup *startup, const char *name, StartupFn fn, bool main_thread, ...);
+int startup_run(Startup *startup, struct App *app);
+double startup_critical_path(Startup *startup);
+void startup_free(Startup *startup);
+
+#define STARTUP_H
+#endif
+
@@ -0,0 +1,243 @@
+#include <string.h>
+#include <rlc/array.h>
+#include "bc.h"
+#include "texture.h"
+
+void textures_init(Textures *textures, VkDevice device, VkPhysicalDevice physical, GpuMemory *gpu_memory, Upload *upload, Bindless *bindless, DeletionQueue *deletion_queue, VkSampler sampler) {
+    assert_arg(textures);
+    textures->device = device;
+    textures->physical = physical;
+    textures->gpu_memory = gpu_memory;
+    textures->upload = upload;
+    textures->bindless = bindless;
+    textures->deletion_queue = deletion_queue;
+    textures->sampler = sampler;
+}
+
+void textures_free(Textures *textures) {
+    assert_arg(textures);
+    for(size_t i = 0; i < array_len(textures->textures); ++i) {
+        Texture *texture = array_it(textures->textures, i);
+        if(texture->view) {
+            vkDestroyImageView(textures->device, texture->view, 0);
+        }
+        gpu_memory_destroy_image(textures->gpu_memory, texture->image, &texture->allocation);
+        ktx2_close(&texture->file);
+    }
+    array_free(textures->textures);
+    array_free(textures->scratch);
+    memset(textures, 0, sizeof(*textures));
+}
+
+/* bytes per texel of the uncompressed formats, 0 if not supported */
+static uint32_t textures_texel_size(VkFormat format) {
+    switch(format) {
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8_SRGB:
+            return 1;
+        case VK_FORMAT_R8G8_UNORM:
+        case VK_FORMAT_R8G8_SRGB:
+            return 2;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+/* tightly packed size of a level as stored in the file */
+static VkDeviceSize textures_level_size(VkFormat format, VkExtent3D extent) {
+    if(bc_block_size(format)) return bc_level_size(format, extent);
+    return (VkDeviceSize)extent.width * extent.height * textures_texel_size(format);
+}
+
+/* maps the file and creates the image, no level is read yet */
+int textures_load(Textures *textures, const char *path) {
+    assert_arg(textures);
+    assert_arg(path);
+    Texture texture = {
+        .path = path,
+        .slot = BINDLESS_DEFAULT,
+    };
+    try(ktx2_open(&texture.file, path));
+    texture.format = texture.file.format;
+    texture.levels = texture.file.levels;
+    uint32_t max_levels = 1;
+    for(uint32_t size = texture.file.extent.width > texture.file.extent.height ? texture.file.extent.width : texture.file.extent.height; size > 1; size >>= 1) {
+        ++max_levels;
+    }
+    if(texture.levels > max_levels) {
+        println("'%s' has %u mip levels, a %ux%u image at most %u", path, texture.levels,
+                texture.file.extent.width, texture.file.extent.height, max_levels);
+        goto error;
+    }
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(textures->physical, texture.format, &properties);
+    if(!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        texture.format = bc_decoded_format(texture.file.format);
+        if(texture.format == VK_FORMAT_UNDEFINED) {
+            println("'%s' format %d can't be sampled and isn't decoded on the cpu", path, (int)texture.file.format);
+            goto error;
+        }
+        texture.decode = true;
+    }
+    if(!bc_block_size(texture.file.format) && !textures_texel_size(texture.file.format)) {
+        println("'%s' format %d isn't supported", path, (int)texture.file.format);
+        goto error;
+    }
+    for(uint32_t i = 0; i < texture.levels; ++i) {
+        VkDeviceSize size = 0;
+        ktx2_level_data(&texture.file, i, &size);
+        VkDeviceSize needed = textures_level_size(texture.file.format, ktx2_level_extent(&texture.file, i));
+        if(size < needed) {
+            println("'%s' level %u has %zu bytes, its extent needs %zu", path, i, (size_t)size, (size_t)needed);
+            goto error;
+        }
+    }
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = texture.format,
+        .extent = texture.file.extent,
+        .mipLevels = texture.levels,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    try(gpu_memory_create_image(textures->gpu_memory, &image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                &texture.image, &texture.allocation));
+    array_push(textures->textures, texture);
+    return 0;
+error:
+    ktx2_close(&texture.file);
+    return -1;
+}
+
+/* the next smallest level, straight from the mapping or decoded into scratch */
+static int textures_queue_level(Textures *textures, Texture *texture, VkDeviceSize *bytes) {
+    assert_arg(textures);
+    assert_arg(texture);
+    assert_arg(bytes);
+    uint32_t level = texture->levels - 1 - texture->queued;
+    VkExtent3D extent = ktx2_level_extent(&texture->file, level);
+    VkDeviceSize size = 0;
+    const void *data = ktx2_level_data(&texture->file, level, &size);
+    /* only the packed level, textures_load checked the file holds it all */
+    size = textures_level_size(texture->file.format, extent);
+    uint32_t block_height = bc_block_size(texture->file.format) ? BC_BLOCK : 1;
+    if(texture->decode) {
+        size = (VkDeviceSize)extent.width * extent.height * 4;
+        array_resize(textures->scratch, size);
+        bc_decode(texture->file.format, data, extent, textures->scratch);
+        data = textures->scratch;
+        block_height = 1;
+    }
+    try(upload_image(textures->upload, texture->image, VK_IMAGE_ASPECT_COLOR_BIT, level, extent, block_height, data, size));
+    /* read after the copy was recorded, it may have flushed the batch before */
+    texture->tickets[level] = upload_ticket(textures->upload);
+    if(++texture->queued == texture->levels) {
+        ktx2_close(&texture->file);
+    }
+    *bytes = size;
+    return 0;
+error:
+    return -1;
+}
+
+/* a level of every texture per round, until the budget is spent. at least
+ * one level is queued, however large */
+int textures_stream(Textures *textures, VkDeviceSize budget) {
+    assert_arg(textures);
+    VkDeviceSize queued = 0;
+    bool progress = true;
+    while(progress && queued < budget) {
+        progress = false;
+        for(size_t i = 0; i < array_len(textures->textures) && queued < budget; ++i) {
+            Texture *texture = array_it(textures->textures, i);
+            if(texture->queued == texture->levels) continue;
+            VkDeviceSize bytes = 0;
+            try(textures_queue_level(textures, texture, &bytes));
+            queued += bytes;
+            progress = true;
+        }
+    }
+    try(upload_flush(textures->upload));
+    return 0;
+error:
+    return -1;
+}
+
+/* publish the levels that arrived, call after upload_poll. frame is the last
+ * one that may still read the old slots */
+int textures_update(Textures *textures, uint64_t frame, bool *changed) {
+    assert_arg(textures);
+    assert_arg(changed);
+    for(size_t i = 0; i < array_len(textures->textures); ++i) {
+        Texture *texture = array_it(textures->textures, i);
+        uint32_t resident = texture->resident;
+        while(resident < texture->queued && upload_done(textures->upload, texture->tickets[texture->levels - 1 - resident])) {
+            ++resident;
+        }
+        if(resident == texture->resident) continue;
+        VkImageViewCreateInfo view_info = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = texture->image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = texture->format,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = texture->levels - resident,
+                .levelCount = resident,
+                .layerCount = 1,
+            },
+        };
+        VkImageView view;
+        try(vkCreateImageView(textures->device, &view_info, 0, &view));
+        uint32_t slot = bindless_add_texture(textures->bindless, view, textures->sampler);
+        if(slot == BINDLESS_INVALID) {
+            vkDestroyImageView(textures->device, view, 0);
+            goto error;
+        }
+        if(texture->view) {
+            bindless_release(textures->bindless, BINDLESS_TEXTURE, texture->slot, frame);
+            deletion_queue_push(textures->deletion_queue, (DeletionEntry){
+                .kind = DELETION_IMAGE_VIEW,
+                .frame = frame,
+                .image_view = texture->view,
+            });
+        }
+        texture->view = view;
+        texture->slot = slot;
+        texture->resident = resident;
+        *changed = true;
+    }
+    return 0;
+error:
+    return -1;
+}
+
+bool textures_streaming(Textures *textures) {
+    assert_arg(textures);
+    for(size_t i = 0; i < array_len(textures->textures); ++i) {
+        Texture *texture = array_it(textures->textures, i);
+        if(texture->resident < texture->levels) return true;
+    }
+    return false;
+}
+
+/* what draws push, the default texture while nothing is resident */
+uint32_t textures_slot(Textures *textures, size_t index) {
+    assert_arg(textures);
+    if(index >= array_len(textures->textures)) return BINDLESS_DEFAULT;
+    return array_it(textures->textures, index)->slot;
+}
@@ -0,0 +1,59 @@
+#ifndef TEXTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "bindless.h"
+#include "deletion_queue.h"
+#include "gpu_memory.h"
+#include "ktx2.h"
+#include "upload.h"
+#include "util.h"
+
+#define TEXTURES_STREAM_BUDGET  ((VkDeviceSize)4 << 20)    // bytes queued per frame
+
+typedef struct Texture {
+    const char *path;
+    Ktx2 file;                  // mapped until every level is queued
+    VkFormat format;            // of the image, R8G8B8A8 if decoded on the cpu
+    bool decode;                // block compressed and not supported by the device
+    uint32_t levels;
+    VkImage image;
+    GpuAllocation allocation;
+    VkImageView view;           // the resident levels only
+    uint32_t slot;              // bindless texture slot of the view, BINDLESS_DEFAULT until a level is resident
+    uint32_t queued;            // levels queued for upload, counted from the smallest
+    uint32_t resident;          // levels uploaded, counted from the smallest, what the view covers
+    uint64_t tickets[KTX2_LEVELS_MAX];  // upload of each level, by level
+} Texture;
+
+/* KTX2 textures streamed a mip level at a time, smallest first. every
+ * texture is drawable after its smallest level arrived and gets sharper as
+ * larger ones follow: once a level is resident the texture gets a new view
+ * over the resident levels and a new bindless slot, the old ones are retired
+ * with the frame. levels go from the mapped file to the staging ring, a
+ * decoded copy of one level is only made for the cpu fallback */
+typedef struct Textures {
+    VkDevice device;
+    VkPhysicalDevice physical;
+    GpuMemory *gpu_memory;
+    Upload *upload;
+    Bindless *bindless;
+    DeletionQueue *deletion_queue;
+    VkSampler sampler;
+    Texture *textures;
+    uint8_t *scratch;           // one decoded level
+} Textures;
+
+void textures_init(Textures *textures, VkDevice device, VkPhysicalDevice physical, GpuMemory *gpu_memory, Upload *upload, Bindless *bindless, DeletionQueue *deletion_queue, VkSampler sampler);
+void textures_free(Textures *textures);
+int textures_load(Textures *textures, const char *path);
+int textures_stream(Textures *textures, VkDeviceSize budget);
+int textures_update(Textures *textures, uint64_t frame, bool *changed);
+bool textures_streaming(Textures *textures);
+uint32_t textures_slot(Textures *textures, size_t index);
+
+#define TEXTURE_H
+#endif
+
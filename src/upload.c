@@ -0,0 +1,371 @@
+#include <string.h>
+#include <rlc/array.h>
+#include "upload.h"
+
+static bool upload_dedicated(Upload *upload) {
+    return upload->transfer_family != upload->graphics_family;
+}
+
+int upload_init(Upload *upload, VkDevice device, GpuMemory *gpu_memory, VkQueue transfer_queue, uint32_t transfer_family, VkQueue graphics_queue, uint32_t graphics_family, VkDeviceSize size) {
+    assert_arg(upload);
+    assert_arg(gpu_memory);
+    memset(upload, 0, sizeof(*upload));
+    upload->device = device;
+    upload->gpu_memory = gpu_memory;
+    upload->transfer_queue = transfer_queue;
+    upload->transfer_family = transfer_family;
+    upload->graphics_queue = graphics_queue;
+    upload->graphics_family = graphics_family;
+    upload->size = size;
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    try(gpu_memory_create_buffer(gpu_memory, &buffer_info,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0,
+                &upload->staging, &upload->staging_allocation));
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = transfer_family,
+    };
+    try(vkCreateCommandPool(device, &pool_info, 0, &upload->transfer_pool));
+    pool_info.queueFamilyIndex = graphics_family;
+    try(vkCreateCommandPool(device, &pool_info, 0, &upload->graphics_pool));
+    VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+    VkFenceCreateInfo fence_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+    };
+    for(size_t i = 0; i < UPLOAD_BATCHES; ++i) {
+        UploadBatch *batch = &upload->batches[i];
+        VkCommandBufferAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = upload->transfer_pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        try(vkAllocateCommandBuffers(device, &alloc_info, &batch->transfer));
+        alloc_info.commandPool = upload->graphics_pool;
+        try(vkAllocateCommandBuffers(device, &alloc_info, &batch->acquire));
+        try(vkCreateSemaphore(device, &semaphore_info, 0, &batch->semaphore));
+        try(vkCreateFence(device, &fence_info, 0, &batch->fence));
+    }
+    return 0;
+error:
+    return -1;
+}
+
+static void upload_retire(Upload *upload, UploadBatch *batch) {
+    assert_arg(upload);
+    assert_arg(batch);
+    upload->tail = batch->ring_head;
+    upload->completed = batch->serial + 1;
+    batch->pending = false;
+}
+
+static void upload_wait_oldest(Upload *upload) {
+    assert_arg(upload);
+    UploadBatch *batch = &upload->batches[upload->completed % UPLOAD_BATCHES];
+    if(!batch->pending) return;
+    vkWaitForFences(upload->device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+    upload_retire(upload, batch);
+}
+
+void upload_poll(Upload *upload) {
+    assert_arg(upload);
+    while(upload->completed < upload->serial) {
+        UploadBatch *batch = &upload->batches[upload->completed % UPLOAD_BATCHES];
+        if(!batch->pending) break;
+        if(vkGetFenceStatus(upload->device, batch->fence) != VK_SUCCESS) break;
+        upload_retire(upload, batch);
+    }
+}
+
+void upload_free(Upload *upload) {
+    assert_arg(upload);
+    for(size_t i = 0; i < UPLOAD_BATCHES; ++i) {
+        UploadBatch *batch = &upload->batches[i];
+        if(batch->pending) {
+            vkWaitForFences(upload->device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+        }
+        vkDestroySemaphore(upload->device, batch->semaphore, 0);
+        vkDestroyFence(upload->device, batch->fence, 0);
+    }
+    vkDestroyCommandPool(upload->device, upload->transfer_pool, 0);
+    vkDestroyCommandPool(upload->device, upload->graphics_pool, 0);
+    if(upload->gpu_memory) {
+        gpu_memory_destroy_buffer(upload->gpu_memory, upload->staging, &upload->staging_allocation);
+    }
+    array_free(upload->buffer_acquires);
+    array_free(upload->image_acquires);
+    memset(upload, 0, sizeof(*upload));
+}
+
+static int upload_begin(Upload *upload) {
+    assert_arg(upload);
+    if(upload->recording) return 0;
+    UploadBatch *batch = &upload->batches[upload->serial % UPLOAD_BATCHES];
+    if(batch->pending) {
+        /* all batch slots busy, the oldest one is this slot */
+        upload_wait_oldest(upload);
+    }
+    batch->serial = upload->serial;
+    try(vkResetFences(upload->device, 1, &batch->fence));
+    try(vkResetCommandBuffer(batch->transfer, 0));
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    try(vkBeginCommandBuffer(batch->transfer, &begin_info));
+    upload->recording = true;
+    return 0;
+error:
+    return -1;
+}
+
+static int upload_staging_alloc(Upload *upload, VkDeviceSize size, VkDeviceSize *offset) {
+    assert_arg(upload);
+    assert_arg(offset);
+    if(size > upload->size) {
+        println("upload of %zu bytes exceeds the %zu byte staging ring", (size_t)size, (size_t)upload->size);
+        return -1;
+    }
+    VkDeviceSize head = (upload->head + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT * UPLOAD_ALIGNMENT;
+    if(head % upload->size + size > upload->size) {
+        /* doesn't fit before the end of the ring, wrap around */
+        head += upload->size - head % upload->size;
+    }
+    while(head + size - upload->tail > upload->size) {
+        if(upload->completed == upload->serial) {
+            if(!upload->recording) {
+                /* ring is empty, bytes skipped by the wrap are free too */
+                upload->tail = head;
+                break;
+            }
+            /* only the batch being recorded holds the space */
+            try(upload_flush(upload));
+        }
+        upload_wait_oldest(upload);
+    }
+    upload->head = head + size;
+    *offset = head % upload->size;
+    return 0;
+error:
+    return -1;
+}
+
+int upload_buffer(Upload *upload, VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size) {
+    assert_arg(upload);
+    assert_arg(data);
+    const unsigned char *bytes = data;
+    VkDeviceSize chunk_max = upload->size / 2;
+    for(VkDeviceSize done = 0; done < size; ) {
+        VkDeviceSize chunk = size - done < chunk_max ? size - done : chunk_max;
+        VkDeviceSize offset = 0;
+        try(upload_staging_alloc(upload, chunk, &offset));
+        try(upload_begin(upload));
+        memcpy((unsigned char *)upload->staging_allocation.mapped + offset, bytes + done, chunk);
+        VkBufferCopy region = {
+            .srcOffset = offset,
+            .dstOffset = dst_offset + done,
+            .size = chunk,
+        };
+        UploadBatch *batch = &upload->batches[upload->serial % UPLOAD_BATCHES];
+        vkCmdCopyBuffer(batch->transfer, upload->staging, dst, 1, &region);
+        done += chunk;
+    }
+    upload->bytes += size;
+    VkBufferMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = dst,
+        .offset = dst_offset,
+        .size = size,
+    };
+    UploadBatch *batch = &upload->batches[upload->serial % UPLOAD_BATCHES];
+    if(upload_dedicated(upload)) {
+        /* release, the matching acquire goes to the graphics queue */
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = upload->transfer_family;
+        barrier.dstQueueFamilyIndex = upload->graphics_family;
+        vkCmdPipelineBarrier(batch->transfer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, 0, 1, &barrier, 0, 0);
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        array_push(upload->buffer_acquires, barrier);
+    } else {
+        vkCmdPipelineBarrier(batch->transfer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, 0, 1, &barrier, 0, 0);
+    }
+    return 0;
+error:
+    return -1;
+}
+
+/* size is the tightly packed level, copied in bands of whole rows of texel
+ * blocks (block_height texels high) that fit in half the ring, like
+ * upload_buffer's chunks */
+int upload_image(Upload *upload, VkImage dst, VkImageAspectFlags aspect, uint32_t mip_level, VkExtent3D extent, uint32_t block_height, const void *data, VkDeviceSize size) {
+    assert_arg(upload);
+    assert_arg(data);
+    assert_arg(block_height);
+    const unsigned char *bytes = data;
+    uint32_t rows = (extent.height + block_height - 1) / block_height;
+    VkDeviceSize row_size = size / rows;
+    if(!row_size || row_size * rows != size) {
+        println("image upload of %zu bytes isn't %u rows of blocks", (size_t)size, rows);
+        return -1;
+    }
+    if(row_size > upload->size / 2) {
+        println("image row of %zu bytes exceeds half the %zu byte staging ring", (size_t)row_size, (size_t)upload->size);
+        return -1;
+    }
+    uint32_t band_rows = (uint32_t)(upload->size / 2 / row_size);
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = dst,
+        .subresourceRange = {
+            .aspectMask = aspect,
+            .baseMipLevel = mip_level,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    for(uint32_t row = 0; row < rows; row += band_rows) {
+        uint32_t count = rows - row < band_rows ? rows - row : band_rows;
+        VkDeviceSize chunk = row_size * count;
+        VkDeviceSize offset = 0;
+        try(upload_staging_alloc(upload, chunk, &offset));
+        try(upload_begin(upload));
+        memcpy((unsigned char *)upload->staging_allocation.mapped + offset, bytes + row_size * row, chunk);
+        UploadBatch *batch = &upload->batches[upload->serial % UPLOAD_BATCHES];
+        if(!row) {
+            /* only before the first band, from undefined again would discard
+             * the ones before. bands in a later batch follow on the same queue */
+            vkCmdPipelineBarrier(batch->transfer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+        }
+        uint32_t y = row * block_height;
+        uint32_t height = count * block_height;
+        VkBufferImageCopy region = {
+            .bufferOffset = offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = aspect,
+                .mipLevel = mip_level,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, (int32_t)y, 0},
+            .imageExtent = {extent.width, height < extent.height - y ? height : extent.height - y, extent.depth},
+        };
+        vkCmdCopyBufferToImage(batch->transfer, upload->staging, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+    upload->bytes += size;
+    UploadBatch *batch = &upload->batches[upload->serial % UPLOAD_BATCHES];
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    if(upload_dedicated(upload)) {
+        /* release, the layout transition happens once, on both sides of the ownership transfer */
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = upload->transfer_family;
+        barrier.dstQueueFamilyIndex = upload->graphics_family;
+        vkCmdPipelineBarrier(batch->transfer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        array_push(upload->image_acquires, barrier);
+    } else {
+        vkCmdPipelineBarrier(batch->transfer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+    }
+    return 0;
+error:
+    return -1;
+}
+
+int upload_flush(Upload *upload) {
+    assert_arg(upload);
+    if(!upload->recording) return 0;
+    UploadBatch *batch = &upload->batches[upload->serial % UPLOAD_BATCHES];
+    try(vkEndCommandBuffer(batch->transfer));
+    bool dedicated = upload_dedicated(upload);
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch->transfer,
+        .signalSemaphoreCount = dedicated ? 1 : 0,
+        .pSignalSemaphores = &batch->semaphore,
+    };
+    try(vkQueueSubmit(upload->transfer_queue, 1, &submit_info, dedicated ? VK_NULL_HANDLE : batch->fence));
+    if(dedicated) {
+        try(vkResetCommandBuffer(batch->acquire, 0));
+        VkCommandBufferBeginInfo begin_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        };
+        try(vkBeginCommandBuffer(batch->acquire, &begin_info));
+        vkCmdPipelineBarrier(batch->acquire, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                0, 0,
+                array_len(upload->buffer_acquires), upload->buffer_acquires,
+                array_len(upload->image_acquires), upload->image_acquires);
+        try(vkEndCommandBuffer(batch->acquire));
+        VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo acquire_info = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &batch->semaphore,
+            .pWaitDstStageMask = &wait_stage,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &batch->acquire,
+        };
+        /* later graphics submits are ordered after the acquire barriers */
+        try(vkQueueSubmit(upload->graphics_queue, 1, &acquire_info, batch->fence));
+    }
+    array_clear(upload->buffer_acquires);
+    array_clear(upload->image_acquires);
+    batch->ring_head = upload->head;
+    batch->pending = true;
+    ++upload->serial;
+    upload->recording = false;
+    return 0;
+error:
+    return -1;
+}
+
+uint64_t upload_ticket(Upload *upload) {
+    assert_arg(upload);
+    return upload->serial;
+}
+
+bool upload_done(Upload *upload, uint64_t ticket) {
+    assert_arg(upload);
+    return ticket < upload->completed;
+}
+
+/* blocks until the batch of the ticket completed, flushing it if still recorded */
+int upload_wait(Upload *upload, uint64_t ticket) {
+    assert_arg(upload);
+    if(ticket >= upload->serial) {
+        try(upload_flush(upload));
+    }
+    while(!upload_done(upload, ticket) && upload->completed < upload->serial) {
+        upload_wait_oldest(upload);
+    }
+    return 0;
+error:
+    return -1;
+}
+
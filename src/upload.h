@@ -0,0 +1,62 @@
+#ifndef UPLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "gpu_memory.h"
+#include "util.h"
+
+#define UPLOAD_STAGING_SIZE     ((VkDeviceSize)32 << 20)
+#define UPLOAD_BATCHES          4
+#define UPLOAD_ALIGNMENT        16  // multiple of 4 and of every texel block size
+
+typedef struct UploadBatch {
+    VkCommandBuffer transfer;   // copies and release barriers, transfer queue
+    VkCommandBuffer acquire;    // acquire barriers, graphics queue (dedicated transfer family only)
+    VkSemaphore semaphore;      // transfer -> acquire
+    VkFence fence;              // whole batch done, staging space can be reused
+    VkDeviceSize ring_head;     // staging ring position at submit
+    uint64_t serial;
+    bool pending;
+} UploadBatch;
+
+/* staging uploads on the transfer queue, the ring buffer stays mapped.
+ * with a dedicated transfer family the queue family ownership is released on
+ * the transfer queue and acquired on the graphics queue, the two submits are
+ * chained with a semaphore so the cpu never waits unless the ring is full */
+typedef struct Upload {
+    VkDevice device;
+    GpuMemory *gpu_memory;
+    VkQueue transfer_queue;
+    VkQueue graphics_queue;
+    uint32_t transfer_family;
+    uint32_t graphics_family;
+    VkCommandPool transfer_pool;
+    VkCommandPool graphics_pool;
+    VkBuffer staging;
+    GpuAllocation staging_allocation;
+    VkDeviceSize size;
+    VkDeviceSize head;          // monotonic, head - tail bytes are in use
+    VkDeviceSize tail;
+    UploadBatch batches[UPLOAD_BATCHES];
+    uint64_t serial;            // serial of the batch being recorded
+    uint64_t completed;         // every batch before this serial completed
+    bool recording;
+    VkBufferMemoryBarrier *buffer_acquires;
+    VkImageMemoryBarrier *image_acquires;
+    VkDeviceSize bytes;         // total bytes uploaded
+} Upload;
+
+int upload_init(Upload *upload, VkDevice device, GpuMemory *gpu_memory, VkQueue transfer_queue, uint32_t transfer_family, VkQueue graphics_queue, uint32_t graphics_family, VkDeviceSize size);
+void upload_free(Upload *upload);
+int upload_buffer(Upload *upload, VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size);
+int upload_image(Upload *upload, VkImage dst, VkImageAspectFlags aspect, uint32_t mip_level, VkExtent3D extent, uint32_t block_height, const void *data, VkDeviceSize size);
+int upload_flush(Upload *upload);
+void upload_poll(Upload *upload);
+uint64_t upload_ticket(Upload *upload);
+bool upload_done(Upload *upload, uint64_t ticket);
+int upload_wait(Upload *upload, uint64_t ticket);
+
+#define UPLOAD_H
+#endif
+